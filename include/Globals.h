@@ -8,6 +8,7 @@
 #include "Preferences.h"
 #include "WiFi.h"
 #include "esp_task_wdt.h"
+#include "MachineGeometry.h"
 
 // Enum for machine states
 enum class MachineState : uint8_t {
@@ -21,9 +22,11 @@ enum class MachineState : uint8_t {
 };
 // Extern declaration of the current machine state
 extern MachineState currentState;
+// Changes the state and wakes tasks that react to it. Not for use in ISRs.
+void setState(MachineState state);
 
 // Constants
-constexpr int MAX_BEAKERS = 6;
+constexpr int MAX_BEAKERS = Geometry::STATIONS;
 constexpr int POWER_LOSS_PIN = 34;
 constexpr int PWM_FREQ = 5000;
 constexpr int PWM_RESOLUTION = 8;
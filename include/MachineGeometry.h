@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+// Station count of the carousel this firmware is built for. Set per
+// PlatformIO environment with -D MACHINE_STATIONS=<n>.
+#ifndef MACHINE_STATIONS
+#define MACHINE_STATIONS 6
+#endif
+
+constexpr uint8_t NO_HEATER = 0xFF; // Station without heater mosfet (rinse / dry positions)
+
+// Rotary axis motion profile after homing, in steps/s and steps/s^2. Same for every carousel size.
+constexpr float R_AXIS_MAX_SPEED = 1000;
+constexpr float R_AXIS_ACCELERATION = 1000;
+
+// Mechanical and electrical description of one carousel size. Positions are
+// rotary steps from the home switch and are only nominal: Calibrate:: can
+// teach and persist the real ones.
+template <uint8_t Stations>
+struct MachineGeometry;
+
+template <>
+struct MachineGeometry<6> {
+    static constexpr uint8_t STATIONS = 6;
+    static constexpr long POSITIONS[STATIONS] = {0, -350, -695, -1055, -1420, -1755};
+    static constexpr uint8_t HEATER_PINS[STATIONS] = {4, 5, 18, 21, 19, 22};
+    static constexpr long STORE_IN_AIR = -877;
+    static constexpr long DIP_DEPTH = -13500;
+};
+
+template <>
+struct MachineGeometry<8> {
+    static constexpr uint8_t STATIONS = 8;
+    static constexpr long POSITIONS[STATIONS] = {0, -263, -526, -789, -1052, -1315, -1578, -1841};
+    static constexpr uint8_t HEATER_PINS[STATIONS] = {4, 5, 18, 21, 19, 22, 13, 16};
+    static constexpr long STORE_IN_AIR = -920;
+    static constexpr long DIP_DEPTH = -13500;
+};
+
+// Only eight spare mosfet outputs exist on the devkit, the last four stations are unheated
+template <>
+struct MachineGeometry<12> {
+    static constexpr uint8_t STATIONS = 12;
+    static constexpr long POSITIONS[STATIONS] = {0, -175, -350, -525, -700, -875, -1050, -1225, -1400, -1575, -1750, -1925};
+    static constexpr uint8_t HEATER_PINS[STATIONS] = {4, 5, 18, 21, 19, 22, 13, 16, NO_HEATER, NO_HEATER, NO_HEATER, NO_HEATER};
+    static constexpr long STORE_IN_AIR = -962;
+    static constexpr long DIP_DEPTH = -13500;
+};
+
+using Geometry = MachineGeometry<MACHINE_STATIONS>;
+
+// Heater channels start after the three indicator channels and must stay clear of the steering channel
+static_assert(Geometry::STATIONS <= 12, "Not enough LEDC channels for this many heaters");
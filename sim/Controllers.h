@@ -0,0 +1,51 @@
+#pragma once
+
+// Heater control laws the benchmark can run against the plant. They see only
+// what the firmware sees: the last DS18B20 reading and the setpoint, and they
+// return an 8 bit duty for ledcWrite().
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace sim {
+
+struct Controller {
+    virtual ~Controller() {}
+    virtual const char* name() const = 0;
+    virtual void reset(int beakers) = 0;
+    virtual uint8_t update(int beaker, double measured, double setpoint, double dt) = 0;
+};
+
+// Full power below the band, off above the setpoint
+struct BangBang : Controller {
+    double hysteresis = 0.3;
+    std::vector<bool> on;
+
+    const char* name() const override { return "bangbang"; }
+    void reset(int beakers) override { on.assign(beakers, false); }
+    uint8_t update(int beaker, double measured, double setpoint, double) override {
+        if (measured < setpoint - hysteresis) on[beaker] = true;
+        else if (measured >= setpoint) on[beaker] = false;
+        return on[beaker] ? 255 : 0;
+    }
+};
+
+// PI with conditional integration so the integral cannot wind up while saturated
+struct PI : Controller {
+    double kp = 60.0;  // Duty per degree
+    double ki = 0.25;  // Duty per degree second
+    std::vector<double> integral;
+
+    const char* name() const override { return "pi"; }
+    void reset(int beakers) override { integral.assign(beakers, 0.0); }
+    uint8_t update(int beaker, double measured, double setpoint, double dt) override {
+        double error = setpoint - measured;
+        double out = kp * error + integral[beaker];
+        if ((out < 255 || error < 0) && (out > 0 || error > 0)) integral[beaker] += ki * error * dt;
+        out = kp * error + integral[beaker];
+        return uint8_t(std::max(0.0, std::min(255.0, out)));
+    }
+};
+
+} // namespace sim
@@ -0,0 +1,106 @@
+#include "Plant.h"
+#include "MachineGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sim {
+
+void Beaker::step(double dt) {
+    double power = params.heaterWatts * duty / 255.0;
+    double loss = (temperature - params.ambient) / params.lossResistance;
+    temperature += (power - loss) / params.heatCapacity * dt;
+    temperature = std::min(temperature, params.boiling);
+}
+
+// xorshift32, so runs are identical on every host
+double TempSensor::gaussian() {
+    double sum = 0;
+    for (int i = 0; i < 12; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        sum += rng / 4294967296.0;
+    }
+    return sum - 6.0;
+}
+
+void TempSensor::step(double dt, double liquid) {
+    probe += (liquid - probe) * std::min(1.0, dt / params.probeTimeConstant);
+    conversionLeft -= dt;
+    if (conversionLeft <= 0) {
+        reading = std::round(sampled / params.resolution) * params.resolution;
+        sampled = probe + params.noise * gaussian();
+        conversionLeft += params.conversionTime;
+    }
+}
+
+void StepperAxis::moveTo(long t) {
+    target = t;
+    homingMove = false;
+}
+
+void StepperAxis::seekSwitch(double s) {
+    homingMove = true;
+    homingSpeed = s;
+}
+
+bool StepperAxis::idle() const {
+    return !homingMove && std::fabs(target - position) < 0.5 && speed == 0.0;
+}
+
+void StepperAxis::step(double dt) {
+    if (homingMove) {
+        speed = homingSpeed;
+        position += speed * dt;
+        if (limit()) {
+            homingMove = false;
+            speed = 0;
+        }
+        return;
+    }
+    double distance = target - position;
+    if (std::fabs(distance) < 0.5) {
+        position = target;
+        speed = 0;
+        return;
+    }
+    // Decelerate when the stopping distance reaches what is left, as AccelStepper does
+    double direction = distance > 0 ? 1.0 : -1.0;
+    double stopping = speed * speed / (2 * params.acceleration);
+    bool sameWay = speed * direction >= 0;
+    if (sameWay && stopping >= std::fabs(distance)) speed -= direction * params.acceleration * dt;
+    else speed += direction * params.acceleration * dt;
+    speed = std::max(-params.maxSpeed, std::min(params.maxSpeed, speed));
+    double moved = speed * dt;
+    if (std::fabs(moved) >= std::fabs(distance) || (sameWay && speed * direction <= 0)) {
+        position = target;
+        speed = 0;
+    } else {
+        position += moved;
+    }
+}
+
+void Stirrer::step(double dt) {
+    double target = params.maxRpm * duty / 1024.0;
+    rpm += (target - rpm) * std::min(1.0, dt / params.timeConstant);
+}
+
+Plant::Plant(int stations, uint32_t seed) : beakers(stations), sensors(stations) {
+    for (int i = 0; i < stations; i++) sensors[i].rng = seed * 2654435761u + i + 1;
+    rotary.params = {R_AXIS_MAX_SPEED, R_AXIS_ACCELERATION, 0};
+    z.params = {3000.0, 3000.0, 0};
+}
+
+void Plant::step(double dt) {
+    for (size_t i = 0; i < beakers.size(); i++) {
+        beakers[i].step(dt);
+        sensors[i].step(dt, beakers[i].temperature);
+    }
+    rotary.step(dt);
+    z.step(dt);
+    stirrer.step(dt);
+    time += dt;
+}
+
+} // namespace sim
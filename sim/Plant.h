@@ -0,0 +1,97 @@
+#pragma once
+
+// Deterministic model of the dip machine hardware driven by MachineLink.cpp,
+// for tuning heating and motion on a desktop instead of the real machine.
+// Everything advances in fixed steps of Plant::step(dt), no wall clock is used.
+
+#include <cstdint>
+#include <vector>
+
+namespace sim {
+
+// One beaker: first-order thermal mass heated by a PWM mosfet, losing heat to ambient
+struct ThermalParams {
+    double heaterWatts = 200.0;      // Heater power at full duty
+    double heatCapacity = 2200.0;    // J/K, ~250 ml water plus glass and hot plate
+    double lossResistance = 0.9;     // K/W to ambient
+    double ambient = 25.0;           // Degrees C
+    double boiling = 100.0;          // Liquid temperature ceiling
+};
+
+struct Beaker {
+    ThermalParams params;
+    double temperature = 25.0;
+    uint8_t duty = 0; // 8 bit, as written with ledcWrite(HEATER_CHANNEL_BASE + i, duty)
+
+    void step(double dt);
+};
+
+// DS18B20: probe lags the liquid, readings are quantised and arrive one conversion late
+struct SensorParams {
+    double conversionTime = 0.750; // Seconds at 12 bit resolution
+    double resolution = 0.0625;    // Degrees per LSB
+    double probeTimeConstant = 4.0;
+    double noise = 0.03;           // Standard deviation before quantisation
+};
+
+struct TempSensor {
+    SensorParams params;
+    double probe = 25.0;
+    double reading = 25.0;       // Last completed conversion
+    double sampled = 25.0;       // Value latched when the running conversion started
+    double conversionLeft = 0.0;
+    uint32_t rng = 1;
+
+    void step(double dt, double liquid);
+    double gaussian();
+};
+
+// AccelStepper style trapezoidal move with a limit switch at switchPosition
+struct AxisParams {
+    double maxSpeed = 1000.0;     // Steps per second
+    double acceleration = 1000.0; // Steps per second squared
+    long switchPosition = 0;      // Switch closes at or beyond this position (towards +)
+};
+
+struct StepperAxis {
+    AxisParams params;
+    double position = 0.0;
+    double speed = 0.0;
+    long target = 0;
+    bool homingMove = false;   // Constant speed towards the switch, as runSpeed() in Move::home()
+    double homingSpeed = 0.0;
+
+    void moveTo(long target);
+    void seekSwitch(double speed);
+    bool limit() const { return position >= params.switchPosition; }
+    bool idle() const;
+    void step(double dt);
+};
+
+// Stirrer DC motor: J dw/dt = k * duty - b * w
+struct StirrerParams {
+    double maxRpm = 600.0;        // At full 10 bit duty
+    double timeConstant = 0.6;    // Seconds
+};
+
+struct Stirrer {
+    StirrerParams params;
+    double rpm = 0.0;
+    uint16_t duty = 0; // 10 bit, as on STEERING_CHANNEL
+
+    void step(double dt);
+};
+
+struct Plant {
+    std::vector<Beaker> beakers;
+    std::vector<TempSensor> sensors;
+    StepperAxis rotary;
+    StepperAxis z;
+    Stirrer stirrer;
+    double time = 0.0;
+
+    Plant(int stations, uint32_t seed);
+    void step(double dt);
+};
+
+} // namespace sim
@@ -0,0 +1,277 @@
+// Controller benchmark: runs reference recipes through the plant model the way
+// loop()/heatingInit() sequence the real machine, and writes the results as JSON.
+//
+//   g++ -std=c++17 -O2 -Isim -Iinclude sim/*.cpp -o sim/bench && ./sim/bench sim/bench_results.json
+//
+// The JSON holds only deterministic figures, so a change in the committed
+// sim/bench_results.json is a behaviour change. CPU time per control tick
+// depends on the host and is only printed.
+
+#include "Controllers.h"
+#include "Plant.h"
+#include "MachineGeometry.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+using namespace sim;
+
+namespace {
+
+constexpr double DT = 0.01;             // Plant step, seconds
+constexpr double CONTROL_PERIOD = 0.1;  // Heater update period
+constexpr double SETTLE_BAND = 0.5;     // Degrees, "at setpoint"
+constexpr double HEAT_TIMEOUT = 7200;   // Give up heating after this many seconds
+constexpr double DIP_LOAD_WATTS = 15;   // Extra loss while the head and strip are in a beaker
+constexpr uint32_t SEED = 1;
+
+// Nominal 6 station geometry, straight from the firmware so changes show up in the results
+using BenchGeometry = MachineGeometry<6>;
+constexpr const long* POSITIONS = BenchGeometry::POSITIONS;
+constexpr long STORE_IN_AIR = BenchGeometry::STORE_IN_AIR;
+constexpr long DIP_DEPTH = BenchGeometry::DIP_DEPTH;
+
+struct Recipe {
+    const char* name;
+    int activeBeakers;
+    int setCycles;
+    int storeIn;
+    double setDipTemperature[6];
+    int setDipDuration[6];
+    int setDipRPM[6];
+};
+
+// The first one is what test/newTask.py sends by default
+const Recipe RECIPES[] = {
+    {"newTask-default", 1, 1, 0, {0, 0, 0, 0, 0, 0}, {1, 1, 1, 1, 1, 1}, {0, 0, 0, 0, 0, 0}},
+    {"hot-single", 1, 2, 1, {90, 0, 0, 0, 0, 0}, {120, 0, 0, 0, 0, 0}, {500, 0, 0, 0, 0, 0}},
+    {"stain-6x3", 6, 3, 0, {60, 45, 0, 70, 37, 25}, {60, 30, 10, 45, 30, 10}, {300, 200, 0, 400, 150, 0}},
+};
+
+struct BeakerResult {
+    double setpoint = 0;
+    double timeToSetpoint = -1; // Since entering HEATING, -1 if never heated or never reached
+    double overshoot = 0;
+};
+
+struct Result {
+    std::string recipe;
+    std::string controller;
+    bool heated = true;
+    double homingTime = 0;
+    double heatUpTime = 0;      // From entering HEATING, as are the timeToSetpoint figures
+    double totalRunTime = 0;
+    double stirrerSpinUp = 0;   // Worst time to 90 % of the commanded rpm
+    long controlTicks = 0;
+    double cpuNsPerTick = 0;
+    std::vector<BeakerResult> beakers;
+};
+
+class Run {
+public:
+    Run(const Recipe& r, Controller& c) : recipe(r), controller(c), plant(BenchGeometry::STATIONS, SEED) {
+        controller.reset(6);
+        result.recipe = r.name;
+        result.controller = c.name();
+        result.beakers.resize(r.activeBeakers);
+        for (int i = 0; i < r.activeBeakers; i++) result.beakers[i].setpoint = r.setDipTemperature[i];
+        // Unhomed start, away from both switches
+        plant.z.position = -5000;
+        plant.rotary.position = -300;
+    }
+
+    Result execute() {
+        home();
+        result.homingTime = plant.time;
+        heat();
+        result.heatUpTime = plant.time - result.homingTime;
+        if (result.heated) {
+            for (int c = 0; c < recipe.setCycles; c++) {
+                for (int j = 0; j < recipe.activeBeakers; j++) {
+                    move(plant.rotary, POSITIONS[j]);
+                    dip(j);
+                }
+            }
+            move(plant.z, 0);
+            if (recipe.storeIn == 0) move(plant.rotary, STORE_IN_AIR);
+            else {
+                move(plant.rotary, POSITIONS[recipe.storeIn - 1]);
+                move(plant.z, DIP_DEPTH);
+            }
+        }
+        result.totalRunTime = plant.time;
+        result.cpuNsPerTick = result.controlTicks ? cpuNs / result.controlTicks : 0;
+        return result;
+    }
+
+private:
+    const Recipe& recipe;
+    Controller& controller;
+    Plant plant;
+    Result result;
+    double nextControl = 0;
+    double heatStart = -1; // Heaters stay off until heat() starts the controller, as in heatingInit()
+    double cpuNs = 0;
+    int dippedIn = -1;
+
+    bool heated(int i) const { return recipe.setDipTemperature[i] > plant.beakers[i].params.ambient + SETTLE_BAND; }
+
+    void tick() {
+        if (heatStart >= 0 && plant.time >= nextControl) {
+            nextControl += CONTROL_PERIOD;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < recipe.activeBeakers; i++) {
+                double set = heated(i) ? recipe.setDipTemperature[i] : 0;
+                plant.beakers[i].duty = controller.update(i, plant.sensors[i].reading, set, CONTROL_PERIOD);
+            }
+            cpuNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            result.controlTicks++;
+        }
+        if (dippedIn >= 0) {
+            Beaker& b = plant.beakers[dippedIn];
+            b.temperature -= DIP_LOAD_WATTS / b.params.heatCapacity * DT;
+        }
+        plant.step(DT);
+        for (int i = 0; i < recipe.activeBeakers; i++) {
+            BeakerResult& r = result.beakers[i];
+            if (!heated(i) || heatStart < 0) continue;
+            double t = plant.beakers[i].temperature;
+            if (r.timeToSetpoint < 0 && t >= r.setpoint - SETTLE_BAND) r.timeToSetpoint = plant.time - heatStart;
+            if (r.timeToSetpoint >= 0) r.overshoot = std::max(r.overshoot, t - r.setpoint);
+        }
+    }
+
+    void wait(double seconds) {
+        double end = plant.time + seconds;
+        while (plant.time < end) tick();
+    }
+
+    void move(StepperAxis& axis, long target) {
+        axis.moveTo(target);
+        while (!axis.idle()) tick();
+    }
+
+    void seek(StepperAxis& axis, double speed) {
+        axis.seekSwitch(speed);
+        while (!axis.limit()) tick();
+    }
+
+    // stepper.setCurrentPosition(0): the switch stays where it is physically
+    void setZero(StepperAxis& axis) {
+        axis.params.switchPosition -= long(std::lround(axis.position));
+        axis.position = 0;
+        axis.target = 0;
+    }
+
+    // Same sequence as Move::home()
+    void home() {
+        seek(plant.z, 1000);
+        setZero(plant.z);
+        move(plant.z, -400);
+        seek(plant.z, 200);
+        setZero(plant.z);
+        move(plant.z, -500);
+        setZero(plant.z);
+
+        seek(plant.rotary, 400);
+        setZero(plant.rotary);
+        move(plant.rotary, -50);
+        seek(plant.rotary, 20);
+        setZero(plant.rotary);
+        move(plant.rotary, -80);
+        setZero(plant.rotary);
+    }
+
+    // HEATING state: wait until every heated beaker reads within the band
+    void heat() {
+        double start = heatStart = nextControl = plant.time;
+        while (true) {
+            bool ready = true;
+            for (int i = 0; i < recipe.activeBeakers; i++) {
+                if (heated(i) && plant.sensors[i].reading < recipe.setDipTemperature[i] - SETTLE_BAND) ready = false;
+            }
+            if (ready) return;
+            if (plant.time - start > HEAT_TIMEOUT) {
+                result.heated = false;
+                return;
+            }
+            tick();
+        }
+    }
+
+    // Same sequence as Move::dip()
+    void dip(int beaker) {
+        move(plant.z, DIP_DEPTH);
+        dippedIn = beaker;
+        int rpm = recipe.setDipRPM[beaker];
+        plant.stirrer.duty = uint16_t(rpm * 1024 / 600);
+        double target = plant.stirrer.params.maxRpm * plant.stirrer.duty / 1024.0;
+        double spinStart = plant.time;
+        double spunUp = -1;
+        double end = plant.time + recipe.setDipDuration[beaker];
+        while (plant.time < end) {
+            tick();
+            if (spunUp < 0 && plant.stirrer.rpm >= 0.9 * target) spunUp = plant.time - spinStart;
+        }
+        if (target > 0 && spunUp >= 0) result.stirrerSpinUp = std::max(result.stirrerSpinUp, spunUp);
+        plant.stirrer.duty = 0;
+        dippedIn = -1;
+        move(plant.z, 0);
+    }
+};
+
+void writeJson(FILE* out, const std::vector<Result>& results) {
+    std::fprintf(out, "{\n  \"dt\": %g,\n  \"controlPeriod\": %g,\n  \"seed\": %u,\n  \"results\": [\n", DT, CONTROL_PERIOD, SEED);
+    for (size_t n = 0; n < results.size(); n++) {
+        const Result& r = results[n];
+        std::fprintf(out, "    {\"recipe\": \"%s\", \"controller\": \"%s\", \"heated\": %s, ", r.recipe.c_str(), r.controller.c_str(), r.heated ? "true" : "false");
+        std::fprintf(out, "\"homingTime\": %.2f, \"heatUpTime\": %.2f, \"totalRunTime\": %.2f, \"stirrerSpinUp\": %.2f, ",
+                     r.homingTime, r.heatUpTime, r.totalRunTime, r.stirrerSpinUp);
+        std::fprintf(out, "\"controlTicks\": %ld,\n     \"beakers\": [", r.controlTicks);
+        for (size_t i = 0; i < r.beakers.size(); i++) {
+            const BeakerResult& b = r.beakers[i];
+            std::fprintf(out, "%s{\"setpoint\": %.1f, \"timeToSetpoint\": %.2f, \"overshoot\": %.3f}",
+                         i ? ", " : "", b.setpoint, b.timeToSetpoint, b.overshoot);
+        }
+        std::fprintf(out, "]}%s\n", n + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "bench_results.json";
+    std::vector<std::unique_ptr<Controller>> controllers;
+    controllers.emplace_back(new BangBang());
+    controllers.emplace_back(new PI());
+
+    std::vector<Result> results;
+    std::printf("%-16s %-9s %9s %9s %9s %11s %8s\n", "recipe", "ctrl", "heat s", "run s", "max os", "worst tts", "ns/tick");
+    for (const Recipe& recipe : RECIPES) {
+        for (auto& controller : controllers) {
+            Result r = Run(recipe, *controller).execute();
+            double overshoot = 0, tts = -1;
+            for (const BeakerResult& b : r.beakers) {
+                overshoot = std::max(overshoot, b.overshoot);
+                tts = std::max(tts, b.timeToSetpoint);
+            }
+            std::printf("%-16s %-9s %9.1f %9.1f %9.2f %11.1f %8.0f\n", r.recipe.c_str(), r.controller.c_str(),
+                        r.heatUpTime, r.totalRunTime, overshoot, tts, r.cpuNsPerTick);
+            results.push_back(r);
+        }
+    }
+
+    FILE* out = std::fopen(path, "w");
+    if (!out) {
+        std::fprintf(stderr, "Cannot write %s\n", path);
+        return 1;
+    }
+    writeJson(out, results);
+    std::fclose(out);
+    std::printf("Results written to %s\n", path);
+    return 0;
+}
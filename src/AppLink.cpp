@@ -1,40 +1,140 @@
 #include "Globals.h"
+#include "MetricsLink/MetricsLink.h"
+#include "IndicatorLink/indicatorLink.h"
+#include "MachineLink/Eta.h"
+#include "MachineLink/MachineLink.h"
+#include "StoreLink/StoreLink.h"
+#include "OtaLink/OtaLink.h"
 
 Preferences preferences;
 AsyncWebServer server(8000);
 AsyncWebSocket ws("/ws");
 
 // Variales only for internal
-struct Network {
-  String ssid;
-  int rssi;
-  bool isOpen;
+constexpr unsigned long SCAN_CACHE_TTL = 30000; // Scan results younger than this are served from cache
+constexpr uint8_t MAX_SCAN_REQUESTS = 8;
+
+struct ScanCache {
+  String json;                 // Last serialized scan result
+  unsigned long scannedAt = 0; // millis() when json was produced
+  bool valid = false;
+  bool scanning = false;       // Async scan in flight
 };
+ScanCache scanCache;
+// Clients waiting on a scan result. Written by the command worker, drained by appLink.
+uint32_t scanRequests[MAX_SCAN_REQUESTS];
+uint8_t scanRequestCount = 0;
+portMUX_TYPE scanMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Incoming websocket messages are reassembled per client, parsed into a Command
+// and queued. commandWorker executes them outside the AsyncTCP callback.
+// Only fragmented messages hold a frame buffer, and only until their last fragment.
+constexpr uint8_t FRAME_BUFFERS = 4;
+constexpr size_t MAX_MESSAGE_SIZE = 2048;
+constexpr uint8_t COMMAND_QUEUE_LENGTH = 8;
+
+struct FrameBuffer {
+  uint32_t clientId = 0;
+  bool inUse = false;
+  bool overflow = false;
+  size_t len = 0;
+  char data[MAX_MESSAGE_SIZE];
+};
+FrameBuffer frameBuffers[FRAME_BUFFERS];
+
+enum class CommandType : uint8_t {
+  SCAN_WIFI,
+  SET_WIFI,
+  NEW,
+  START,
+  RECHECK,
+  RECOVER,
+  ABORT,
+  JOG,
+  TEACH,
+  TEACH_PROBE,
+  SAVE_CALIBRATION,
+  RESET_CALIBRATION,
+  ALLOW_UPDATE
+};
+const char* const COMMAND_NAMES[] = {"scanWiFi", "setWiFi", "new", "start", "recheck", "recover", "abort",
+                                     "jog", "teach", "teachProbe", "saveCalibration", "resetCalibration", "allowUpdate"};
+
+struct StartParams {
+  uint8_t activeBeakers;
+  int setCycles;
+  uint8_t storeIn;
+  float setDipTemperature[MAX_BEAKERS];
+  int setDipDuration[MAX_BEAKERS];
+  int setDipRPM[MAX_BEAKERS];
+};
+
+struct WiFiParams {
+  char ssid[33];
+  char password[65];
+};
+
+struct CalibrateParams {
+  long steps;      // jog
+  uint8_t station; // teach, teachProbe
+};
+
+struct Command {
+  CommandType type;
+  uint32_t clientId;
+  union {
+    StartParams start;
+    WiFiParams wifi;
+    CalibrateParams calibrate;
+  };
+};
+QueueHandle_t commandQueue;
+
+// Last broadcast payload, sent to new clients on connect instead of rebuilding state
+constexpr unsigned long CONNECT_CHECK_INTERVAL = 10000; // Min gap between sensor probes triggered by connects
+String statusSnapshot;
+SemaphoreHandle_t snapshotMutex = xSemaphoreCreateMutex();
+unsigned long lastConnectCheck = 0;
 MachineState currentState = MachineState::IDLE;
 MachineInfo machineInfo;
 #define BROADCAST (ws.count() > 0 && MACHINE_HEATING || MACHINE_WORKING && millis() - broadcast_counter > 3000)
 
 // ************** Function Prototypes **************
 void HandleWiFi();
-void scanNetworks();
+void onWiFiEvent(WiFiEvent_t event);
+void requestScan(uint32_t clientId);
+void handleScan();
 void updateWiFi(const char* ssid, const char* pass);
 void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
 void checkPowerLoss();
 void printMachineInfo(const MachineInfo& info);
-void startMachine(const JsonDocument& doc, MachineInfo& info);
+void startMachine(const StartParams& params, MachineInfo& info);
+void commandWorker(void * parameters);
+void sendAck(uint32_t clientId, const char* command, bool ok, const char* error = nullptr);
+
+void setState(MachineState state) {
+  currentState = state;
+  indicatorNotify();
+} // setState
 
 // ========================== Main: appLinkInit =========================
 void appLinkInit(void * parameters) {
   // Connect to wifi
+  WiFi.onEvent(onWiFiEvent, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+  WiFi.onEvent(onWiFiEvent, ARDUINO_EVENT_WIFI_STA_GOT_IP);
   HandleWiFi();
 
+    // Start command worker before accepting clients
+    commandQueue = xQueueCreate(COMMAND_QUEUE_LENGTH, sizeof(Command));
+    xTaskCreate(commandWorker, "commands", 4096, NULL, 1, NULL);
+
     // Start Websocket Server
     ws.onEvent(onWsEvent);
     server.addHandler(&ws);
+    metricsInit(server);
+    otaInit(server);
     server.begin();
 
-    // Start OTA
-    ArduinoOTA.begin();
     if (!MDNS.begin("dipmachine")) {
       Serial.println("Error setting up MDNS responder!");
     } else {
@@ -43,13 +143,8 @@ void appLinkInit(void * parameters) {
     }
 
     // Recover data stored in memory (if any)
-    preferences.begin(machineInfoStore, true);
-    size_t len = preferences.getBytesLength("data");
-    if (len == sizeof(machineInfo)) {
-      preferences.getBytes("data", &machineInfo, sizeof(machineInfo));
-      printMachineInfo(machineInfo);
-    }
-    preferences.end();
+    if (Store::load(machineInfo)) printMachineInfo(machineInfo);
+    checkPowerLoss(); // Seeds the snapshot served to new clients
 
     esp_task_wdt_init(50, true);
     esp_task_wdt_add(NULL);
@@ -57,45 +152,98 @@ void appLinkInit(void * parameters) {
     unsigned long wdt_counter = millis();
     unsigned long broadcast_counter = millis();
     while (true) {
+      unsigned long tickStart = micros();
       if (WDT_TRIGGER){
         esp_task_wdt_reset();
         wdt_counter = millis();
       }
+      if (MACHINE_HEATING || MACHINE_WORKING) machineInfo.timeLeft = Eta::timeLeft();
       if (BROADCAST){
         printMachineInfo(machineInfo);
         broadcast("WORKING");
         broadcast_counter = millis();
       }
-      ArduinoOTA.handle();
+      handleScan();
+      otaHandle();
+      metricsUpdate(ws.count());
+      metricsRecordLoop(micros() - tickStart);
       vTaskDelay(pdMS_TO_TICKS(10));
     }
 } // appLinkInit
 
 // =======================================| WiFi functions |================================================
-void scanNetworks() {
-    Serial.println("[scanNetworks] Searching for avaliable networks...");
-    int n = WiFi.scanNetworks();
-    Network* networks = new Network[n];
-    JsonDocument doc;
+// Runs on the command worker: only records who asked, never touches the radio.
+void requestScan(uint32_t clientId) {
+  portENTER_CRITICAL(&scanMux);
+  bool queued = false;
+  for (uint8_t i = 0; i < scanRequestCount; i++) {
+    if (scanRequests[i] == clientId) queued = true;
+  }
+  if (!queued && scanRequestCount < MAX_SCAN_REQUESTS) {
+    scanRequests[scanRequestCount++] = clientId;
+  }
+  portEXIT_CRITICAL(&scanMux);
+} // requestScan
+
+// Sends the cached result, or a failed scanWiFi ack, to every waiting client and clears the queue
+void replyScanRequests(const char* error = nullptr) {
+  uint32_t pending[MAX_SCAN_REQUESTS];
+  portENTER_CRITICAL(&scanMux);
+  uint8_t count = scanRequestCount;
+  memcpy(pending, scanRequests, count * sizeof(uint32_t));
+  scanRequestCount = 0;
+  portEXIT_CRITICAL(&scanMux);
+
+  for (uint8_t i = 0; i < count; i++) {
+    if (error) sendAck(pending[i], "scanWiFi", false, error);
+    else if (ws.hasClient(pending[i])) ws.text(pending[i], scanCache.json);
+  }
+} // replyScanRequests
+
+// Runs on every appLink tick. Starts an async scan when needed and publishes it once complete.
+void handleScan() {
+  if (scanCache.scanning) {
+    int n = WiFi.scanComplete();
+    if (n == WIFI_SCAN_RUNNING) return;
+    scanCache.scanning = false;
+    if (n == WIFI_SCAN_FAILED) {
+      // Not cached: the next request retries instead of getting an empty list for SCAN_CACHE_TTL
+      Serial.println("[handleScan] Scan failed");
+      replyScanRequests("scan failed");
+      return;
+    }
 
+    JsonDocument doc;
     for (int i = 0; i < n; i++) {
-        networks[i].ssid = WiFi.SSID(i);
-        networks[i].rssi = WiFi.RSSI(i);
-        networks[i].isOpen = (WiFi.encryptionType(i) == WIFI_AUTH_OPEN);
-
-        // Create a JSON object for each network
-        JsonObject network = doc[networks[i].ssid].to<JsonObject>();
-        network["rssi"] = networks[i].rssi;
-        network["isOpen"] = networks[i].isOpen;
+      JsonObject network = doc[WiFi.SSID(i)].to<JsonObject>();
+      network["rssi"] = WiFi.RSSI(i);
+      network["isOpen"] = (WiFi.encryptionType(i) == WIFI_AUTH_OPEN);
     }
-    // Serialize the JSON document to a string
-    String jsonString;
-    serializeJson(doc, jsonString);
-    // Send the JSON string to all WebSocket clients
-    ws.textAll(jsonString);
-    delete[] networks;
-    Serial.println("[scanNetworks] Done");
-} // scanNetworks
+    WiFi.scanDelete();
+
+    scanCache.json = "";
+    serializeJson(doc, scanCache.json);
+    scanCache.scannedAt = millis();
+    scanCache.valid = true;
+    Serial.printf("[handleScan] Done, %d networks\n", n);
+    replyScanRequests();
+    return;
+  }
+
+  if (scanRequestCount == 0) return;
+  if (scanCache.valid && millis() - scanCache.scannedAt < SCAN_CACHE_TTL) {
+    replyScanRequests();
+    return;
+  }
+  Serial.println("[handleScan] Searching for avaliable networks...");
+  if (WiFi.scanNetworks(true) == WIFI_SCAN_FAILED) {
+    // Fail the waiting requests rather than retrying on every tick
+    Serial.println("[handleScan] Could not start scan");
+    replyScanRequests("could not start scan");
+    return;
+  }
+  scanCache.scanning = true;
+} // handleScan
 
 void updateWiFi(const char* ssid, const char* pass){
     Serial.println("[updateWiFi] Storing WiFi Credentials");
@@ -111,6 +259,18 @@ void updateWiFi(const char* ssid, const char* pass){
     }
 } // updateWiFi
 
+// Runs on the WiFi event task. A reconnect is an IP regained after the link dropped.
+void onWiFiEvent(WiFiEvent_t event) {
+  static bool linkLost = false;
+  if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+    if (!linkLost) linkStats.wifiDisconnects++;
+    linkLost = true;
+  } else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP && linkLost) {
+    linkLost = false;
+    linkStats.wifiReconnects++;
+  }
+} // onWiFiEvent
+
 void HandleWiFi() {
     // Initialize preferences and read stored SSID and password
     preferences.begin("wifi");
@@ -124,13 +284,12 @@ void HandleWiFi() {
 
     unsigned long counter = millis();
     // Attempt to connect to WiFi
+    indicatorSetCondition(Condition::WIFI_CONNECTING, true);
     while (WiFi.status() != WL_CONNECTED && millis() - counter < 5000) {
         Serial.print(".");
-        digitalWrite(BUILTIN_LED, HIGH);
-        vTaskDelay(pdMS_TO_TICKS(100));
-        digitalWrite(BUILTIN_LED, LOW);
-        vTaskDelay(pdMS_TO_TICKS(100));
+        vTaskDelay(pdMS_TO_TICKS(200));
     }
+    indicatorSetCondition(Condition::WIFI_CONNECTING, false);
 
     if (WiFi.status() == WL_CONNECTED) {
         Serial.println("\n[HandleWiFi] WiFi Connected!");
@@ -152,127 +311,207 @@ void HandleWiFi() {
     }
 } // HandleWiFi
 
-// ========================| OTA function |=================================
-void initOTA(){
-  Serial.println("Initializing OTA");
-  ArduinoOTA
-    .onStart([]() {
-      String type;
-      if (ArduinoOTA.getCommand() == U_FLASH)
-        type = "sketch";
-      else // U_SPIFFS
-        type = "filesystem";
-      Serial.println("Start updating " + type);
-    })
-    .onEnd([]() {
-      Serial.println("\nEnd");
-    })
-    .onProgress([](unsigned int progress, unsigned int total) {
-      Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
-      esp_task_wdt_reset(); // Feed the watchdog timer
-    })
-    .onError([](ota_error_t error) {
-      Serial.printf("Error[%u]: ", error);
-      if (error == OTA_AUTH_ERROR) Serial.println("Auth Failed");
-      else if (error == OTA_BEGIN_ERROR) Serial.println("Begin Failed");
-      else if (error == OTA_CONNECT_ERROR) Serial.println("Connect Failed");
-      else if (error == OTA_RECEIVE_ERROR) Serial.println("Receive Failed");
-      else if (error == OTA_END_ERROR) Serial.println("End Failed");
-    });
-} // initOTA
-
 // =======================| Checking function |=============================
 void checkPowerLoss(){
   if (machineInfo.powerLoss){
     Serial.println("[checkPowerLoss] PowerLoss Detected");
+    indicatorSetCondition(Condition::POWER_LOSS, true);
     broadcast("POWERLOSS");
   } else broadcast("IDLE");
 } // checkPowerLoss
 
 // =========================| State Changing Functions |========================
-void startMachine(const JsonDocument& doc, MachineInfo& info) {
+void startMachine(const StartParams& params, MachineInfo& info) {
   Serial.println("[startMachine] Started Heating");
-  info.activeBeakers = doc["activeBeakers"];
-  info.setCycles = doc["setCycles"];
-  info.storeIn = doc["storeIn"];
-  JsonArrayConst setDipTemperature = doc["setDipTemperature"];
+  info.activeBeakers = params.activeBeakers;
+  info.setCycles = params.setCycles;
+  info.storeIn = params.storeIn;
   for (int i = 0; i < info.activeBeakers; i++) {
-      info.setDipTemperature[i] = setDipTemperature[i];
+      info.setDipTemperature[i] = params.setDipTemperature[i];
+      info.setDipDuration[i] = params.setDipDuration[i];
+      info.setDipRPM[i] = params.setDipRPM[i];
   }
+  Store::saveRecipe(info);
+  Store::saveProgress(info);
+  setState(MachineState::HEATING);
+} // startMachine
 
-  JsonArrayConst setDipDuration = doc["setDipDuration"];
-  for (int i = 0; i < info.activeBeakers; i++) {
-      info.setDipDuration[i] = setDipDuration[i];
+// =========================| Command handling |==============================
+void sendAck(uint32_t clientId, const char* command, bool ok, const char* error){
+  char out[128];
+  if (error) snprintf(out, sizeof(out), "{\"ack\":\"%s\",\"ok\":%s,\"error\":\"%s\"}", command, ok ? "true" : "false", error);
+  else snprintf(out, sizeof(out), "{\"ack\":\"%s\",\"ok\":%s}", command, ok ? "true" : "false");
+  if (ws.hasClient(clientId)) ws.text(clientId, out);
+} // sendAck
+
+// Fills cmd from a parsed message. Returns an error string, or nullptr on success.
+const char* parseCommand(const JsonDocument& doc, Command& cmd){
+  const char* status = doc["state"] | "";
+  bool found = false;
+  for (uint8_t i = 0; i < sizeof(COMMAND_NAMES) / sizeof(COMMAND_NAMES[0]); i++) {
+    if (strcmp(status, COMMAND_NAMES[i]) == 0) {
+      cmd.type = CommandType(i);
+      found = true;
+      break;
+    }
   }
+  if (!found) return "unknown command";
 
-  JsonArrayConst setDipRPM = doc["setDipRPM"];
-  for (int i = 0; i < info.activeBeakers; i++) {
-      info.setDipRPM[i] = setDipRPM[i];
+  if (cmd.type == CommandType::SET_WIFI) {
+    strlcpy(cmd.wifi.ssid, doc["ssid"] | "", sizeof(cmd.wifi.ssid));
+    strlcpy(cmd.wifi.password, doc["password"] | "", sizeof(cmd.wifi.password));
+    if (cmd.wifi.ssid[0] == '\0') return "missing ssid";
   }
-  currentState = MachineState::HEATING;
-} // startMachine
+  else if (cmd.type == CommandType::START) {
+    StartParams& p = cmd.start;
+    int activeBeakers = doc["activeBeakers"] | 0;
+    if (activeBeakers < 1 || activeBeakers > MAX_BEAKERS) return "invalid activeBeakers";
+    p.activeBeakers = activeBeakers;
+    p.setCycles = doc["setCycles"] | 0;
+    p.storeIn = doc["storeIn"] | 0;
+    if (p.setCycles < 1) return "invalid setCycles";
+    if (p.storeIn > MAX_BEAKERS) return "invalid storeIn";
+
+    JsonArrayConst setDipTemperature = doc["setDipTemperature"];
+    JsonArrayConst setDipDuration = doc["setDipDuration"];
+    JsonArrayConst setDipRPM = doc["setDipRPM"];
+    if (setDipTemperature.size() < p.activeBeakers || setDipDuration.size() < p.activeBeakers || setDipRPM.size() < p.activeBeakers) {
+      return "recipe arrays shorter than activeBeakers";
+    }
+    for (int i = 0; i < p.activeBeakers; i++) {
+      p.setDipTemperature[i] = setDipTemperature[i];
+      p.setDipDuration[i] = setDipDuration[i];
+      p.setDipRPM[i] = setDipRPM[i];
+    }
+  }
+  else if (cmd.type == CommandType::JOG) {
+    cmd.calibrate.steps = constrain(doc["steps"] | 0L, -MAX_JOG_STEPS, MAX_JOG_STEPS);
+  }
+  else if (cmd.type == CommandType::TEACH) {
+    int station = doc["station"] | -1;
+    if (station < 0 || station > STORE_IN_AIR_STATION) return "invalid station";
+    cmd.calibrate.station = station;
+  }
+  else if (cmd.type == CommandType::TEACH_PROBE) {
+    int station = doc["station"] | -1;
+    if (station < 0 || station >= MAX_BEAKERS) return "invalid station";
+    cmd.calibrate.station = station;
+  }
+  return nullptr;
+} // parseCommand
 
-// =========================| Websocket Event handling |==============================
-void processClientMessage(char* message){
+// Runs in the AsyncTCP callback: parse and queue only, no NVS or 1-Wire access here.
+void ingestMessage(const char* message, size_t len, uint32_t clientId){
   JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, message);
+  DeserializationError error = deserializeJson(doc, message, len);
   if (error) {
-    Serial.print("[processClientMessage] deserializeJson() failed: ");
-    Serial.println(error.c_str());
+    sendAck(clientId, "message", false, error.c_str());
     return;
-  } else Serial.println(message);
-
-  String status = doc["state"];
-  // Handle wifi functions
-  if (status == "scanWiFi") { // scan for wifi
-      Serial.println("[processClientMessage] scanning wifi");
-      scanNetworks();
-      return;
-  }
-  if (status == "setWiFi") { // Set wifi
-      Serial.println("[processClientMessage] setting wifi");
-      String ssid = doc["ssid"];
-      String password = doc["password"];
-      updateWiFi(ssid.c_str(), password.c_str());
-      return;
   }
-  // Handle new start
-  if (status == "new"){ // Start new machine
-    Serial.println("[processClientMessage] Setting new machine");
-    clearAll();
-    broadcast("IDLE");
-    currentState = MachineState::IDLE;
+  Command cmd;
+  cmd.clientId = clientId;
+  const char* parseError = parseCommand(doc, cmd);
+  if (parseError) {
+    sendAck(clientId, "message", false, parseError);
     return;
   }
-  if (status == "start"){ // Start new machine
-    Serial.println("[processClientMessage] Starting machine");
-    startMachine(doc, machineInfo);
-    return;
+  // Abort must not wait behind a slow command
+  if (cmd.type == CommandType::ABORT) setState(MachineState::ABORT);
+
+  if (xQueueSend(commandQueue, &cmd, 0) != pdTRUE) {
+    // The abort already took effect and the machineLink task finishes it, so it is not "busy"
+    if (cmd.type == CommandType::ABORT) sendAck(clientId, COMMAND_NAMES[uint8_t(cmd.type)], true);
+    else sendAck(clientId, COMMAND_NAMES[uint8_t(cmd.type)], false, "busy");
   }
-  // Check again
-  if(status == "recheck"){
-    checkSensors();
+} // ingestMessage
+
+void executeCommand(const Command& cmd){
+  const char* name = COMMAND_NAMES[uint8_t(cmd.type)];
+  Serial.printf("[executeCommand] %s from client %u\n", name, cmd.clientId);
+  switch (cmd.type) {
+  case CommandType::SCAN_WIFI:
+    requestScan(cmd.clientId); // Results are sent once the scan completes
+    break;
+  case CommandType::SET_WIFI:
+    sendAck(cmd.clientId, name, true); // Ack first, the client may lose its link
+    updateWiFi(cmd.wifi.ssid, cmd.wifi.password);
     return;
-  }
- // handle recovery from power loss
-  if (status == "recover"){
+  case CommandType::NEW:
+    clearAll();
+    setState(MachineState::IDLE);
+    broadcast("IDLE");
+    break;
+  case CommandType::START:
+    if (!MACHINE_IDLE) {
+      sendAck(cmd.clientId, name, false, "machine busy");
+      return;
+    }
+    if (otaActive) {
+      sendAck(cmd.clientId, name, false, "update in progress");
+      return;
+    }
+    startMachine(cmd.start, machineInfo);
+    break;
+  case CommandType::RECHECK:
+    checkSensors();
+    break;
+  case CommandType::RECOVER:
     if (!machineInfo.powerLoss){
-      Serial.println("[processClientMessage] Recovery attempt failed!");
+      Serial.println("[executeCommand] Recovery attempt failed!");
+      sendAck(cmd.clientId, name, false, "no power loss recorded");
       return;
     }
-    Serial.println("[processClientMessage] Recovering from powerloss");
     machineInfo.powerLoss = false;
-    currentState = MachineState::HOMING;
-    return;
+    indicatorSetCondition(Condition::POWER_LOSS, false);
+    setState(MachineState::HOMING);
+    break;
+  case CommandType::ABORT:
+    // ingestMessage already set ABORT, the machineLink task stops motion and the stirrer and returns to IDLE
+    break;
+  case CommandType::ALLOW_UPDATE:
+    otaAllowOverride();
+    break;
+  case CommandType::JOG:
+  case CommandType::TEACH:
+  case CommandType::TEACH_PROBE:
+  case CommandType::SAVE_CALIBRATION:
+  case CommandType::RESET_CALIBRATION: {
+    bool ok = true;
+    if (cmd.type == CommandType::JOG) {
+      const char* error = Calibrate::jog(cmd.calibrate.steps);
+      if (error) {
+        sendAck(cmd.clientId, name, false, error);
+        return;
+      }
+    }
+    else if (cmd.type == CommandType::TEACH) ok = Calibrate::teach(cmd.calibrate.station);
+    else if (cmd.type == CommandType::TEACH_PROBE && MACHINE_IDLE) {
+      if (!Calibrate::teachProbe(cmd.calibrate.station)) {
+        sendAck(cmd.clientId, name, false, "need exactly one unassigned probe");
+        return;
+      }
+    }
+    else if (cmd.type == CommandType::SAVE_CALIBRATION) ok = Calibrate::save();
+    else if (MACHINE_IDLE) Calibrate::reset();
+    else ok = false;
+    if (!ok) {
+      sendAck(cmd.clientId, name, false, "machine not idle");
+      return;
+    }
+    break;
   }
-// handle abortion
-  if (status == "abort"){ // abort current operation
-    Serial.println("[processClientMessage] Aborting");
-    currentState = MachineState::ABORT;
-    broadcast("IDLE");
-    return;
   }
-} // processClientMessage
+  sendAck(cmd.clientId, name, true);
+} // executeCommand
+
+void commandWorker(void * parameters){
+  Command cmd;
+  while (true) {
+    if (xQueueReceive(commandQueue, &cmd, portMAX_DELAY) == pdTRUE) {
+      executeCommand(cmd);
+    }
+  }
+} // commandWorker
 
 void clearAll() {
   preferences.begin(machineInfoStore, false);
@@ -281,38 +520,95 @@ void clearAll() {
   Serial.println("[clearAll] machineInfoStore & machineInfo cleared!");
 
   memset(&machineInfo, 0, sizeof(MachineInfo)); //
+  indicatorSetCondition(Condition::POWER_LOSS, false);
   machineInfo.activeBeakers = 1;
 } // clearAll
 
-void clientConnected(){
-  if (MACHINE_IDLE || MACHINE_HOMING){
-    checkPowerLoss(); // sends POWERLOSS if true
-    checkSensors(); // sends HALTED if true
-  }  
-  else if (MACHINE_HEATING || MACHINE_WORKING){
-    broadcast("WORKING");
-  }
-  else if (MACHINE_DONE){
-    broadcast("DONE");
-    currentState = MachineState::IDLE;
-    vTaskDelay(pdMS_TO_TICKS(5000));
-    broadcast("IDLE");
+// Runs in the AsyncTCP callback: replies to this client only and never blocks.
+void clientConnected(AsyncWebSocketClient *client){
+  if (xSemaphoreTake(snapshotMutex, pdMS_TO_TICKS(5)) == pdTRUE) {
+    if (statusSnapshot.length() > 0) client->text(statusSnapshot);
+    xSemaphoreGive(snapshotMutex);
+  }
+  // Sensors may have been unplugged while idle, let the worker re-probe them.
+  // Rate limited so a burst of reconnects causes a single 1-Wire scan.
+  if ((MACHINE_IDLE || MACHINE_HOMING) && millis() - lastConnectCheck > CONNECT_CHECK_INTERVAL) {
+    lastConnectCheck = millis();
+    Command cmd;
+    cmd.type = CommandType::RECHECK;
+    cmd.clientId = 0; // Internal, no ack
+    xQueueSend(commandQueue, &cmd, 0);
   }
-}
+} // clientConnected
+
+// =========================| Websocket Event handling |==============================
+// Returns the client's buffer, claiming a free one if claim is set
+FrameBuffer* frameBufferFor(uint32_t clientId, bool claim){
+  FrameBuffer* freeSlot = nullptr;
+  for (auto& fb : frameBuffers) {
+    if (fb.inUse && fb.clientId == clientId) return &fb;
+    if (!fb.inUse && !freeSlot) freeSlot = &fb;
+  }
+  if (!claim) return nullptr;
+  if (freeSlot) {
+    freeSlot->inUse = true;
+    freeSlot->clientId = clientId;
+    freeSlot->len = 0;
+    freeSlot->overflow = false;
+  }
+  return freeSlot;
+} // frameBufferFor
+
+void releaseFrameBuffer(uint32_t clientId){
+  for (auto& fb : frameBuffers) {
+    if (fb.inUse && fb.clientId == clientId) fb.inUse = false;
+  }
+} // releaseFrameBuffer
 
 void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
   if (type == WS_EVT_CONNECT) {
     Serial.printf("[onWsEvent][%s] Client connected\n", client->remoteIP().toString().c_str());
-    clientConnected();
+    linkStats.wsConnects++;
+    clientConnected(client);
   } else if (type == WS_EVT_DISCONNECT) {
+    releaseFrameBuffer(client->id());
+    linkStats.wsDisconnects++;
     Serial.println("[onWsEvent] Client disconnected");
   } else if (type == WS_EVT_DATA) {
     AwsFrameInfo *info = (AwsFrameInfo*)arg;
-    if (info->final && info->index == 0 && info->len == len) {
-      data[len] = '\0';  // Null-terminate the data
-      Serial.printf("[onWsEvent][%s] %s\n", client->remoteIP().toString().c_str(), (char*)data);
-      processClientMessage((char*)data);
+    if (info->message_opcode != WS_TEXT) return;
+    bool messageStart = (info->num == 0 && info->index == 0);
+
+    // Whole message in one event, the usual case: parse straight from the TCP buffer
+    if (messageStart && info->final && info->len == len) {
+      if (len >= MAX_MESSAGE_SIZE) sendAck(client->id(), "message", false, "message too large");
+      else ingestMessage((const char*)data, len, client->id());
+      return;
     }
+
+    FrameBuffer* fb = frameBufferFor(client->id(), messageStart);
+    if (!fb) {
+      if (messageStart) sendAck(client->id(), "message", false, "busy");
+      return; // Rest of a message that got no buffer
+    }
+    if (messageStart) {
+      fb->len = 0;
+      fb->overflow = false;
+    }
+    if (!fb->overflow && fb->len + len < MAX_MESSAGE_SIZE) {
+      memcpy(fb->data + fb->len, data, len);
+      fb->len += len;
+    } else fb->overflow = true;
+
+    // Wait for the last packet of the final frame
+    if (!info->final || info->index + len != info->len) return;
+
+    if (fb->overflow) sendAck(client->id(), "message", false, "message too large");
+    else {
+      fb->data[fb->len] = '\0';
+      ingestMessage(fb->data, fb->len, client->id());
+    }
+    fb->inUse = false;
   }
 } // onWsEvent
 
@@ -341,6 +637,10 @@ void broadcast(String state, String error){
   }
   String output;
   serializeJson(doc, output);
+  if (xSemaphoreTake(snapshotMutex, portMAX_DELAY) == pdTRUE) {
+    statusSnapshot = output;
+    xSemaphoreGive(snapshotMutex);
+  }
   ws.textAll(output);
 } // broadcast
 
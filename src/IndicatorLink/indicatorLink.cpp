@@ -1,113 +1,130 @@
 #include <IndicatorLink/indicatorLink.h>
-
-void indicatorLink(){
-    ledcSetup(0, PWM_FREQ, PWM_RESOLUTION);
-    ledcSetup(1, PWM_FREQ, PWM_RESOLUTION);
-    ledcSetup(2, PWM_FREQ, PWM_RESOLUTION);
-    ledcAttachPin(RED_PIN, 0);
-    ledcAttachPin(GREEN_PIN, 1);
-    ledcAttachPin(BLUE_PIN, 2);
-
-    while (true){
-        switch (currentState)
-        {
-        case MachineState::IDLE:
-            break;
-        case MachineState::HOMING:
-            break;
-        case MachineState::HALTED:
-            break;
-        case MachineState::WORKING:
-            break;
-        case MachineState::HEATING:
-            break;
+#include "driver/ledc.h"
+
+// Pattern shown for each MachineState, indexed by the enum value
+const IndicatorPattern STATE_PATTERNS[] = {
+    {Pattern::PULSE, 0, 0, 255, 3000, 0},   // IDLE: slow blue breathing
+    {Pattern::BLINK, 255, 160, 0, 300, 2},  // HOMING: two amber blinks
+    {Pattern::PULSE, 0, 255, 0, 2000, 0},   // WORKING: green breathing
+    {Pattern::BLINK, 255, 0, 0, 300, 3},    // HALTED: three red blinks
+    {Pattern::SOLID, 0, 255, 0, 0, 0},      // DONE: solid green
+    {Pattern::PULSE, 255, 80, 0, 2000, 0},  // HEATING: orange breathing
+    {Pattern::SOLID, 255, 0, 0, 0, 0},      // ABORT: solid red
+};
+
+// Pattern shown while a condition is active, indexed by Condition
+const IndicatorPattern CONDITION_PATTERNS[] = {
+    {Pattern::PULSE, 255, 0, 0, 600, 0},    // POWER_LOSS: fast red breathing
+    {Pattern::PULSE, 0, 255, 255, 400, 0},  // WIFI_CONNECTING: fast cyan breathing
+};
+
+TaskHandle_t indicatorTask = NULL;
+volatile uint8_t activeConditions = 0; // Bit per Condition
+portMUX_TYPE conditionMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Highest priority active condition, or the current state's pattern
+const IndicatorPattern& currentPattern(uint8_t& key) {
+    uint8_t conditions = activeConditions;
+    for (uint8_t c = 0; c < uint8_t(Condition::COUNT); c++) {
+        if (conditions & (1 << c)) {
+            key = 0x80 | c;
+            return CONDITION_PATTERNS[c];
         }
     }
+    key = uint8_t(currentState);
+    return STATE_PATTERNS[key];
 }
 
-void fadeTo(uint8_t targetRed, uint8_t targetGreen, uint8_t targetBlue, unsigned long duration) {
-    uint8_t startRed = ledcRead(0);
-    uint8_t startGreen = ledcRead(1);
-    uint8_t startBlue = ledcRead(2);
-    
-    unsigned long startTime = millis();
-    unsigned long elapsedTime;
-    
-    do {
-        elapsedTime = millis() - startTime;
-        float progress = (float)elapsedTime / duration;
-        
-        uint8_t currentRed = startRed + (targetRed - startRed) * progress;
-        uint8_t currentGreen = startGreen + (targetGreen - startGreen) * progress;
-        uint8_t currentBlue = startBlue + (targetBlue - startBlue) * progress;
-        
-        ledcWrite(0, currentRed);
-        ledcWrite(1, currentGreen);
-        ledcWrite(2, currentBlue);
-        
-        vTaskDelay(pdMS_TO_TICKS(10));  // Small delay to prevent overwhelming the system
-    } while (elapsedTime < duration);
-}
-
-void pulse(uint8_t red, uint8_t green, uint8_t blue, unsigned long duration) {
-    unsigned long halfDuration = duration / 2;
-    
-    // Fade in
-    fadeTo(red, green, blue, halfDuration);
-    
-    // Fade out
-    fadeTo(0, 0, 0, halfDuration);
-}
-
-void blink(uint8_t red, uint8_t green, uint8_t blue, unsigned long onDuration, unsigned long offDuration) {
-    ledcWrite(0, red);
-    ledcWrite(1, green);
-    ledcWrite(2, blue);
-    delay(onDuration);
-    
-    ledcWrite(0, 0);
-    ledcWrite(1, 0);
-    ledcWrite(2, 0);
-    delay(offDuration);
-}
-namespace indicate {
-
-
-void Wifi_connecting(unsigned long duration) {
-    unsigned long endTime = millis() + duration;
-    while (millis() < endTime) {
-        for (int i = 0; i < 3; i++) {
-            blink(0, 0, 255, 200, 200);  // Three fast blue blinks
+// Starts a hardware fade on all three channels and returns immediately.
+// A fade still running on a channel delays the new one until it completes.
+void fadeTo(uint8_t red, uint8_t green, uint8_t blue, uint32_t duration) {
+    const uint8_t channels[3] = {RED_CHANNEL, GREEN_CHANNEL, BLUE_CHANNEL};
+    const uint8_t duties[3] = {red, green, blue};
+    for (uint8_t i = 0; i < 3; i++) {
+        ledc_channel_t channel = ledc_channel_t(channels[i]);
+        if (duration == 0) {
+            ledc_set_duty(LEDC_HIGH_SPEED_MODE, channel, duties[i]);
+            ledc_update_duty(LEDC_HIGH_SPEED_MODE, channel);
+        } else {
+            ledc_set_fade_with_time(LEDC_HIGH_SPEED_MODE, channel, duties[i], duration);
+            ledc_fade_start(LEDC_HIGH_SPEED_MODE, channel, LEDC_FADE_NO_WAIT);
         }
-        vTaskDelay(pdMS_TO_TICKS(1000));  // Pause between sets of blinks
     }
 }
-void Wifi_connected(){
-    
-}
-void AP_Started(){
-    
-}
-
-void homing(){
 
+// Programs one segment of the pattern. Returns how long the segment lasts,
+// or 0 if it holds until the next state change.
+uint32_t runStep(const IndicatorPattern& p, uint32_t step) {
+    switch (p.type) {
+    case Pattern::SOLID:
+        if (step == 0) fadeTo(p.red, p.green, p.blue, SOLID_FADE_MS);
+        return 0;
+    case Pattern::PULSE:
+        if (step % 2 == 0) fadeTo(p.red, p.green, p.blue, p.periodMs / 2);
+        else fadeTo(0, 0, 0, p.periodMs / 2);
+        return p.periodMs / 2;
+    case Pattern::BLINK: {
+        uint32_t k = step % (2 * p.blinks + 1);
+        if (k == 2 * p.blinks) {
+            fadeTo(0, 0, 0, 0);
+            return BLINK_GAP_MS;
+        }
+        if (k % 2 == 0) fadeTo(p.red, p.green, p.blue, 0);
+        else fadeTo(0, 0, 0, 0);
+        return p.periodMs / 2;
+    }
+    }
+    return 0;
 }
-void idle(){
 
+void indicatorLink(void * params) {
+    ledcSetup(RED_CHANNEL, PWM_FREQ, PWM_RESOLUTION);
+    ledcSetup(GREEN_CHANNEL, PWM_FREQ, PWM_RESOLUTION);
+    ledcSetup(BLUE_CHANNEL, PWM_FREQ, PWM_RESOLUTION);
+    ledcAttachPin(RED_PIN, RED_CHANNEL);
+    ledcAttachPin(GREEN_PIN, GREEN_CHANNEL);
+    ledcAttachPin(BLUE_PIN, BLUE_CHANNEL);
+    ledc_fade_func_install(0);
+    indicatorTask = xTaskGetCurrentTaskHandle();
+
+    uint8_t shown = 0xFF;
+    uint32_t step = 0;
+    while (true) {
+        uint8_t key;
+        const IndicatorPattern& pattern = currentPattern(key);
+        if (key != shown) {
+            shown = key;
+            step = 0;
+        }
+        uint32_t wait = runStep(pattern, step++);
+        // Sleep until the segment ends or the state changes, the fade unit runs the ramp
+        ulTaskNotifyTake(pdTRUE, wait ? pdMS_TO_TICKS(wait) : portMAX_DELAY);
+    }
 }
-void heating(){
 
+// Wakes the indicator after a state change
+void indicatorNotify() {
+    if (indicatorTask) xTaskNotifyGive(indicatorTask);
 }
-void working(){
 
+void IRAM_ATTR indicatorNotifyFromISR() {
+    if (!indicatorTask) return;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(indicatorTask, &woken);
+    if (woken) portYIELD_FROM_ISR();
 }
 
-void aborted(){
-
+void indicatorSetCondition(Condition condition, bool active) {
+    portENTER_CRITICAL(&conditionMux);
+    if (active) activeConditions |= 1 << uint8_t(condition);
+    else activeConditions &= ~(1 << uint8_t(condition));
+    portEXIT_CRITICAL(&conditionMux);
+    indicatorNotify();
 }
 
-void done(){
-
+void IRAM_ATTR indicatorSetConditionFromISR(Condition condition) {
+    portENTER_CRITICAL_ISR(&conditionMux);
+    activeConditions |= 1 << uint8_t(condition);
+    portEXIT_CRITICAL_ISR(&conditionMux);
+    indicatorNotifyFromISR();
 }
-
-}
\ No newline at end of file
@@ -2,9 +2,41 @@
 #include <Arduino.h>
 #include <Globals.h>
 
-int RED_PIN = 2;
-int GREEN_PIN = 14;
-int BLUE_PIN = 27;
-int RED_CHANNEL = 0;
-int GREEN_CHANNEL = 1;
-int BLUE_CHANNEL = 2;
\ No newline at end of file
+constexpr int RED_PIN = 2;
+constexpr int GREEN_PIN = 14;
+constexpr int BLUE_PIN = 27;
+constexpr int RED_CHANNEL = 0;
+constexpr int GREEN_CHANNEL = 1;
+constexpr int BLUE_CHANNEL = 2;
+
+constexpr uint32_t BLINK_GAP_MS = 1200;  // Dark pause after a group of blinks
+constexpr uint32_t SOLID_FADE_MS = 300;  // Transition time into a solid colour
+
+enum class Pattern : uint8_t {
+    SOLID, // Fade to the colour and hold
+    PULSE, // Fade in and out continuously over periodMs
+    BLINK  // `blinks` flashes of periodMs, then BLINK_GAP_MS dark
+};
+
+// Conditions shown over the state pattern, highest priority first
+enum class Condition : uint8_t {
+    POWER_LOSS,
+    WIFI_CONNECTING,
+    COUNT
+};
+
+struct IndicatorPattern {
+    Pattern type;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint16_t periodMs;
+    uint8_t blinks;
+};
+
+// Functions
+void indicatorLink(void * params);
+void indicatorNotify();
+void IRAM_ATTR indicatorNotifyFromISR();
+void indicatorSetCondition(Condition condition, bool active);
+void IRAM_ATTR indicatorSetConditionFromISR(Condition condition);
@@ -0,0 +1,131 @@
+#include "Eta.h"
+#include "MachineLink.h"
+
+namespace Eta{
+int lastPredicted = 0;
+int lastActual = 0;
+int lastError = 0;
+
+// Learned per-unit costs
+float transferScale = 1.0f; // Measured / profile time of rotary transfers
+float msPerZStroke = NOMINAL_MS_PER_Z_STROKE;
+float heatRate = NOMINAL_HEAT_RATE;
+
+// Work left in the run, reduced by stepDone()
+float remainingTransferMs = 0; // Profile time, before transferScale
+int remainingZStrokes = 0;
+unsigned long remainingDwellMs = 0;
+float heatGap = 0; // Largest setpoint gap while HEATING, 0 afterwards
+
+long cursorPosition = 0;          // Rotary position the next transfer starts from
+unsigned long stepStart = 0;      // millis() when the step in progress started
+unsigned long currentStepMs = 0;  // Predicted cost of the step in progress
+unsigned long runStart = 0;
+unsigned long heatStart = 0;
+
+float smooth(float model, float sample){
+  return model + ETA_SMOOTHING * (sample - model);
+}
+
+// Time of an AccelStepper move: accelerate, cruise at max speed if reached, decelerate
+float profileMs(long steps){
+  constexpr float rampSteps = R_AXIS_MAX_SPEED * R_AXIS_MAX_SPEED / R_AXIS_ACCELERATION; // Both ramps
+  float d = labs(steps);
+  if (d >= rampSteps) return (d / R_AXIS_MAX_SPEED + R_AXIS_MAX_SPEED / R_AXIS_ACCELERATION) * 1000;
+  return 2 * sqrtf(d / R_AXIS_ACCELERATION) * 1000;
+}
+
+unsigned long stepCost(long fromPosition, uint8_t beakerNum){
+  return profileMs(beakerPosition(beakerNum) - fromPosition) * transferScale
+       + 2 * msPerZStroke
+       + machineInfo.setDipDuration[beakerNum] * 1000UL;
+}
+
+unsigned long remainingMs(){
+  return remainingTransferMs * transferScale
+       + remainingZStrokes * msPerZStroke
+       + remainingDwellMs
+       + (heatGap > 0 ? heatGap / heatRate * 1000 : 0);
+}
+
+float largestGap(){
+  float gap = 0;
+  for (uint8_t i = 0; i < machineInfo.activeBeakers; i++) {
+    gap = max(gap, machineInfo.setDipTemperature[i] - machineInfo.currentTemps[i]);
+  }
+  return gap;
+}
+
+// Builds the totals for everything left from onCycle/onBeaker, including the final store move.
+// currentTemps must be fresh, the heat-up estimate is taken from them.
+void begin(){
+  remainingTransferMs = 0;
+  remainingZStrokes = 0;
+  remainingDwellMs = 0;
+  long position = rotaryPosition(); // Parked at the store position after a finished run, not at beaker 0
+  for (int c = machineInfo.onCycle; c < machineInfo.setCycles; c++) {
+    uint8_t first = (c == machineInfo.onCycle) ? machineInfo.onBeaker : 0;
+    for (uint8_t j = first; j < machineInfo.activeBeakers; j++) {
+      remainingTransferMs += profileMs(beakerPosition(j) - position);
+      position = beakerPosition(j);
+      remainingZStrokes += 2;
+      remainingDwellMs += machineInfo.setDipDuration[j] * 1000UL;
+    }
+  }
+  remainingTransferMs += profileMs(storePosition(machineInfo.storeIn) - position);
+  if (machineInfo.storeIn != 0) remainingZStrokes++;
+
+  heatGap = largestGap();
+  cursorPosition = rotaryPosition();
+  runStart = heatStart = stepStart = millis();
+  currentStepMs = heatGap > 0 ? heatGap / heatRate * 1000 : 0;
+  lastPredicted = remainingMs() / 1000;
+  Serial.printf("[Eta] Predicted run time: %d s\n", lastPredicted);
+}
+
+void heatingDone(){
+  unsigned long elapsed = millis() - heatStart;
+  if (heatGap > 1 && elapsed >= MIN_HEAT_LEARN_MS) heatRate = smooth(heatRate, heatGap / (elapsed / 1000.0f));
+  heatGap = 0;
+  stepStart = millis();
+  currentStepMs = stepCost(cursorPosition, machineInfo.onBeaker);
+}
+
+void recordTransfer(long steps, unsigned long ms){
+  if (steps > 0) transferScale = smooth(transferScale, ms / profileMs(steps));
+}
+
+void recordStroke(unsigned long ms){
+  msPerZStroke = smooth(msPerZStroke, ms);
+}
+
+// Called after the dip in beakerNum completed: removes exactly that step from the totals
+void stepDone(uint8_t beakerNum){
+  long position = beakerPosition(beakerNum);
+  remainingTransferMs = max(0.0f, remainingTransferMs - profileMs(position - cursorPosition));
+  remainingZStrokes = max(0, remainingZStrokes - 2);
+  unsigned long dwell = machineInfo.setDipDuration[beakerNum] * 1000UL;
+  remainingDwellMs = remainingDwellMs > dwell ? remainingDwellMs - dwell : 0;
+  cursorPosition = position;
+
+  uint8_t next = (beakerNum + 1 < machineInfo.activeBeakers) ? beakerNum + 1 : 0;
+  stepStart = millis();
+  currentStepMs = stepCost(cursorPosition, next);
+}
+
+void finish(){
+  lastActual = (millis() - runStart) / 1000;
+  lastError = lastPredicted - lastActual;
+  remainingTransferMs = 0;
+  remainingZStrokes = 0;
+  remainingDwellMs = 0;
+  Serial.printf("[Eta] Predicted %d s, actual %d s, error %d s\n", lastPredicted, lastActual, lastError);
+}
+
+// Seconds left. Time spent in the current step counts down up to that step's predicted cost.
+int timeLeft(){
+  unsigned long inStep = min(millis() - stepStart, currentStepMs);
+  unsigned long remaining = remainingMs();
+  return (remaining > inStep ? remaining - inStep : 0) / 1000;
+}
+} // namespace Eta
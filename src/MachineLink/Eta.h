@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Globals.h"
+
+// Nominal models, used until the first measurement of each kind replaces them.
+// Rotary transfers follow the trapezoidal profile of the R axis, scaled by a learned factor.
+constexpr float NOMINAL_MS_PER_Z_STROKE = 5500.0f; // One full dip stroke, in or out
+constexpr float NOMINAL_HEAT_RATE = 0.02f;         // Degrees C per second of the slowest beaker
+constexpr float ETA_SMOOTHING = 0.3f;              // Weight of a new measurement in the running average
+constexpr unsigned long MIN_HEAT_LEARN_MS = 60000; // Shorter heat-ups say nothing about heatRate
+
+// Time remaining estimate for the current run. Totals are built once at begin()
+// and reduced as steps complete; measurements only refine the per-unit models.
+namespace Eta{
+    void begin();
+    void heatingDone();
+    void recordTransfer(long steps, unsigned long ms);
+    void recordStroke(unsigned long ms);
+    void stepDone(uint8_t beakerNum);
+    void finish();
+    int timeLeft();
+
+    // Result of the last completed run, in seconds
+    extern int lastPredicted;
+    extern int lastActual;
+    extern int lastError; // predicted - actual
+} // namespace Eta
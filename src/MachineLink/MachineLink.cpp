@@ -1,4 +1,5 @@
 #include "MachineLink.h"
+#include "Eta.h"
 
 OneWire oneWire(TEMP_SENSOR_PIN);
 DallasTemperature sensors(&oneWire);
@@ -8,9 +9,15 @@ AccelStepper stepper_R(1, ROTARY_AXIS_STEP_PIN, ROTARY_AXIS_DIR_PIN);
 AccelStepper stepper_Z(1, Z_AXIS_STEP_PIN, Z_AXIS_DIR_PIN);
 
 // Global variables
-const int beakerDistance[6] = {0, -350, -695, -1055, -1420, -1755};
+volatile bool machineHomed = false;
+// Station positions in use, nominal from Geometry until loadCalibration() runs
+long stationPositions[MAX_BEAKERS];
+long storeInAirPosition = Geometry::STORE_IN_AIR;
+const long dipDistance = Geometry::DIP_DEPTH;
+
+#if MACHINE_STATIONS == 6
 // Hardcoded sensor addresses
-DeviceAddress sensorAddresses[MAX_BEAKERS] = {
+const DeviceAddress DEFAULT_SENSOR_ADDRESSES[MAX_BEAKERS] = {
   { 0x28, 0x12, 0xCC, 0x16, 0xA8, 0x01, 0x3C, 0x13 }, // 1
   { 0x28, 0xDB, 0x09, 0x16, 0xA8, 0x01, 0x3C, 0xEA }, // 2
   { 0x28, 0xAC, 0x2F, 0x16, 0xA8, 0x01, 0x3C, 0x93 }, // 3
@@ -18,26 +25,41 @@ DeviceAddress sensorAddresses[MAX_BEAKERS] = {
   { 0x28, 0x0E, 0x12, 0x16, 0xA8, 0x01, 0x3C, 0xC9 }, // 5
   { 0x28, 0x4B, 0xFF, 0x16, 0xA8, 0x01, 0x3C, 0x61 }  // 6
 };
+#else
+// No fixed probes, each station's probe is taught with Calibrate::teachProbe()
+const DeviceAddress DEFAULT_SENSOR_ADDRESSES[MAX_BEAKERS] = {};
+#endif
+// Probe address per station, defaults until loadCalibration() runs
+DeviceAddress sensorAddresses[MAX_BEAKERS];
+// Jog handoff: the command worker only queues steps, the machineLink task owns stepper_R
+volatile long jogRequest = 0;    // Steps queued by Calibrate::jog(), 0 when none
+volatile bool jogActive = false; // A jog move is in progress on the machineLink task
 
 // Function Prototype
 void getTemp();
 void heatingLoop();
+void runJog();
+void cancelJog();
 // =======================| Heating Handling Code |===========================
 void heatingInit(void * params){
   ledcSetup(STEERING_CHANNEL, 5000, 10);
   ledcAttachPin(STEERING_MOTOR_PIN, STEERING_CHANNEL);
   ledcWrite(STEERING_CHANNEL, 0);
 
-  for (size_t i = 3; i < 9; i++){
-    ledcSetup(i, PWM_FREQ, PWM_RESOLUTION);
-    ledcAttachPin(MOSFET_PINS[i-3], i);
-    ledcWrite(i, 255);
+  for (size_t i = 0; i < MAX_BEAKERS; i++){
+    if (Geometry::HEATER_PINS[i] == NO_HEATER) continue;
+    ledcSetup(HEATER_CHANNEL_BASE + i, PWM_FREQ, PWM_RESOLUTION);
+    ledcAttachPin(Geometry::HEATER_PINS[i], HEATER_CHANNEL_BASE + i);
+    ledcWrite(HEATER_CHANNEL_BASE + i, 255);
     vTaskDelay(pdMS_TO_TICKS(100));
   }  
-  for (size_t i = 3; i < 9; i++){
-    ledcWrite(i, 0);
+  for (size_t i = 0; i < MAX_BEAKERS; i++){
+    if (Geometry::HEATER_PINS[i] == NO_HEATER) continue;
+    ledcWrite(HEATER_CHANNEL_BASE + i, 0);
     vTaskDelay(pdMS_TO_TICKS(100));
   }
+  sensors.begin();
+  loadCalibration();
   
   pinMode(Z_AXIS_LIMIT_PIN, INPUT_PULLDOWN);
   pinMode(ROTARY_AXIS_LIMIT_PIN, INPUT_PULLDOWN);
@@ -46,23 +68,34 @@ void heatingInit(void * params){
   esp_task_wdt_init(50, true);
   esp_task_wdt_add(NULL);
   unsigned long wdt_counter = millis();
-  currentState = MachineState::HOMING;
+  setState(MachineState::HOMING);
   Move::home();
-  currentState = MachineState::IDLE;
+  machineHomed = true;
+  setState(MachineState::IDLE);
 
   while (true){
     if (WDT_TRIGGER){
       esp_task_wdt_reset();
       wdt_counter = millis();
     }
+    else if (jogActive || jogRequest != 0){
+      if (MACHINE_IDLE) runJog();
+      else cancelJog(); // Any state change ends a jog
+    }
     else if (MACHINE_HEATING){
+      getTemp(); // currentTemps is only refreshed while WORKING, Eta needs the real gap
+      Eta::begin();
       heatingLoop();
+      Eta::heatingDone();
       broadcast("WORKING");
-      currentState = MachineState::WORKING;
+      setState(MachineState::WORKING);
     }
     else if (MACHINE_ABORT){
+      // Sole owner of ABORT -> IDLE, so an abort the command worker never sees still completes
+      stepper_R.setCurrentPosition(stepper_R.currentPosition()); // Drops the target of an interrupted transfer
       ledcWrite(STEERING_CHANNEL, 0);
-      currentState == MachineState::IDLE;
+      setState(MachineState::IDLE);
+      broadcast("IDLE");
     }
     else if (MACHINE_WORKING){
       checkSensors();
@@ -104,6 +137,8 @@ void checkSensors() {
   bool allConnected = true;
   String message = "Disconnected sensors: ";
   for (size_t i = 0; i < MAX_BEAKERS; ++i) {
+    if (Geometry::HEATER_PINS[i] == NO_HEATER) continue; // Unheated stations have no probe
+    if (sensorAddresses[i][0] == 0) continue; // Not taught yet, must not halt calibration
     if (isSensorConnected(sensorAddresses[i])) {
       Serial.printf("Sensor %d Connected\n", i + 1);
     } else {
@@ -114,18 +149,141 @@ void checkSensors() {
   }
   if (!allConnected) {
     broadcast("HALTED", message);
-    currentState = MachineState::HALTED;
+    setState(MachineState::HALTED);
   }
 }
 
 void getTemp(){
+  sensors.requestTemperatures();
   for (size_t i = 0; i < machineInfo.activeBeakers; i++){
-    machineInfo.currentTemps[i] = sensors.getTempCByIndex(i);
+    machineInfo.currentTemps[i] = sensors.getTempC(sensorAddresses[i]);
   }
 }
+// =======================| Calibration Code |===========================
+long beakerPosition(uint8_t beakerNum){
+  return stationPositions[beakerNum];
+}
+
+// Rotary position the strip is presented at, storeIn 0 is in air
+long storePosition(uint8_t storeIn){
+  return storeIn == 0 ? storeInAirPosition : stationPositions[storeIn - 1];
+}
+
+// Where the rotary axis is now, not necessarily a station after a finished run
+long rotaryPosition(){
+  return stepper_R.currentPosition();
+}
+
+// Loads taught positions and probes. Ignored if they were saved by a different station count.
+void loadCalibration(){
+  Calibrate::reset();
+  Preferences calibration;
+  calibration.begin(calibrationStore, true);
+  if (calibration.getUChar("stations", 0) == MAX_BEAKERS &&
+      calibration.getBytesLength("positions") == sizeof(stationPositions)) {
+    calibration.getBytes("positions", stationPositions, sizeof(stationPositions));
+    storeInAirPosition = calibration.getInt("storeInAir", Geometry::STORE_IN_AIR);
+    Serial.println("[loadCalibration] Using taught station positions");
+  }
+  if (calibration.getUChar("stations", 0) == MAX_BEAKERS &&
+      calibration.getBytesLength("probes") == sizeof(sensorAddresses)) {
+    calibration.getBytes("probes", sensorAddresses, sizeof(sensorAddresses));
+    Serial.println("[loadCalibration] Using taught probe mapping");
+  }
+  calibration.end();
+} // loadCalibration
+
+// Runs one step of a jog on the machineLink task, starting it from jogRequest first. Stops on the home switch.
+void runJog(){
+  if (!jogActive) {
+    stepper_R.move(jogRequest);
+    jogActive = true; // Set before the request is cleared so Calibrate::jog() always sees one of them
+    jogRequest = 0;
+  }
+  bool towardsHome = stepper_R.distanceToGo() > 0; // Home switch is at the positive end
+  if (stepper_R.distanceToGo() == 0 || (towardsHome && digitalRead(ROTARY_AXIS_LIMIT_PIN))) {
+    cancelJog();
+    Serial.printf("[runJog] Stopped at %ld\n", stepper_R.currentPosition());
+    return;
+  }
+  stepper_R.run();
+} // runJog
+
+// Drops a queued or running jog, machineLink task only
+void cancelJog(){
+  stepper_R.setCurrentPosition(stepper_R.currentPosition()); // Drops the target and the speed
+  jogActive = false;
+  jogRequest = 0;
+} // cancelJog
+
+namespace Calibrate{
+// Moves the rotary axis relative to where it is, to line a station up by hand.
+// Returns once the move is queued, the machineLink task runs it. nullptr on success.
+const char* jog(long steps){
+  if (!MACHINE_IDLE || !machineHomed) return "machine not idle";
+  if (stepper_Z.currentPosition() != 0) return "head is lowered"; // e.g. stored in a beaker by done()
+  if (jogActive || jogRequest != 0) return "jog in progress";
+  jogRequest = steps;
+  return nullptr;
+}
+
+// Records the current rotary position for a station, STORE_IN_AIR_STATION for the air position
+bool teach(uint8_t station){
+  if (!MACHINE_IDLE || station > STORE_IN_AIR_STATION || jogActive || jogRequest != 0) return false;
+  if (station == STORE_IN_AIR_STATION) storeInAirPosition = stepper_R.currentPosition();
+  else stationPositions[station] = stepper_R.currentPosition();
+  Serial.printf("[Calibrate] Station %d at %ld\n", station, stepper_R.currentPosition());
+  return true;
+}
+
+// Maps the one probe on the bus that no other station owns to this station.
+// Plug the probes in one at a time and teach each as it is connected.
+bool teachProbe(uint8_t station){
+  if (!MACHINE_IDLE || station >= MAX_BEAKERS || Geometry::HEATER_PINS[station] == NO_HEATER) return false;
+  sensors.begin(); // Re-enumerate, the probe may have just been plugged in
+  DeviceAddress address, candidate;
+  uint8_t unassigned = 0;
+  for (uint8_t i = 0; sensors.getAddress(address, i); i++) {
+    bool owned = false;
+    for (uint8_t s = 0; s < MAX_BEAKERS; s++) {
+      if (s != station && memcmp(sensorAddresses[s], address, sizeof(DeviceAddress)) == 0) owned = true;
+    }
+    if (!owned) {
+      memcpy(candidate, address, sizeof(DeviceAddress));
+      unassigned++;
+    }
+  }
+  if (unassigned != 1) {
+    Serial.printf("[Calibrate] Station %d: %d unassigned probes on the bus, need exactly one\n", station, unassigned);
+    return false;
+  }
+  memcpy(sensorAddresses[station], candidate, sizeof(DeviceAddress));
+  Serial.printf("[Calibrate] Probe taught for station %d\n", station);
+  return true;
+}
+
+bool save(){
+  if (!MACHINE_IDLE) return false;
+  Preferences calibration;
+  calibration.begin(calibrationStore, false);
+  calibration.putUChar("stations", MAX_BEAKERS);
+  calibration.putBytes("positions", stationPositions, sizeof(stationPositions));
+  calibration.putInt("storeInAir", storeInAirPosition);
+  calibration.putBytes("probes", sensorAddresses, sizeof(sensorAddresses));
+  calibration.end();
+  return true;
+}
+
+// Back to the nominal Geometry table and default probes. Stored calibration is kept until the next save().
+void reset(){
+  for (uint8_t i = 0; i < MAX_BEAKERS; i++) stationPositions[i] = Geometry::POSITIONS[i];
+  memcpy(sensorAddresses, DEFAULT_SENSOR_ADDRESSES, sizeof(sensorAddresses));
+  storeInAirPosition = Geometry::STORE_IN_AIR;
+}
+} // namespace Calibrate
+
 // =======================| Motion Handling Code |===========================
 namespace Move{
-const int dipDistance = -13500;
 
 void dip(int duration, int rpm){
 // Dips the head in solution and starts sterring
@@ -133,6 +291,7 @@ void dip(int duration, int rpm){
 
   stepper_Z.moveTo(dipDistance);
   Serial.printf("[dip] Duration: %i   RPM: %i\n", duration, rpm);
+  unsigned long strokeStart = millis();
   while (stepper_Z.currentPosition() != dipDistance) {
     stepper_Z.run();
     if (RUN) {
@@ -140,6 +299,7 @@ void dip(int duration, int rpm){
       return;
     }
   }
+  Eta::recordStroke(millis() - strokeStart);
   // calculate rpm to pwm here
   int dutyCycle = map(rpm, 0, 600, 0, 1024);
   digitalWrite(STEERING_MOTOR_PIN, HIGH);
@@ -153,7 +313,9 @@ void dip(int duration, int rpm){
   }
   // stop the steering
   ledcWrite(STEERING_CHANNEL, 0);
+  strokeStart = millis();
   stepper_Z.runToNewPosition(0);
+  Eta::recordStroke(millis() - strokeStart);
   Serial.println("[dip] Pulling out");
 } // dip
 
@@ -203,23 +365,26 @@ void home(){
   stepper_R.runToNewPosition(-80);
   stepper_R.setCurrentPosition(0);
 
-  stepper_R.setAcceleration(1000);
-  stepper_R.setMaxSpeed(1000);
-  stepper_R.setSpeed(1000);
+  stepper_R.setAcceleration(R_AXIS_ACCELERATION);
+  stepper_R.setMaxSpeed(R_AXIS_MAX_SPEED);
+  stepper_R.setSpeed(R_AXIS_MAX_SPEED);
   Serial.println("[home] R Axis Homed.");
 } // next
 
 void moveToBeaker(uint8_t beakerNum){
     // Moves the head to the given beaker
     Serial.printf("[moveToBeaker] Moving to %i", beakerNum);
-    stepper_R.moveTo(beakerDistance[beakerNum]);
-    while (stepper_R.currentPosition() != beakerDistance[beakerNum]) {
+    long steps = labs(stationPositions[beakerNum] - stepper_R.currentPosition());
+    unsigned long moveStart = millis();
+    stepper_R.moveTo(stationPositions[beakerNum]);
+    while (stepper_R.currentPosition() != stationPositions[beakerNum]) {
       stepper_R.run();
       if (RUN) {
         abort();
         return;
       }
     }
+    Eta::recordTransfer(steps, millis() - moveStart);
 } // next
 
 void done(){
@@ -227,18 +392,20 @@ void done(){
     Serial.println("[Done] Presenting ..");
     stepper_Z.runToNewPosition(0);
     if (machineInfo.storeIn == 0){ // In air selected
-      stepper_R.runToNewPosition(-877);
+      stepper_R.runToNewPosition(storePosition(0));
       Serial.printf("[Done] Storing the strip In Air;");
     } else {
       Serial.printf("Storing the strip in beaker: %d", machineInfo.storeIn - 1);
-      stepper_R.runToNewPosition(beakerDistance[machineInfo.storeIn - 1]);
+      stepper_R.runToNewPosition(storePosition(machineInfo.storeIn));
       stepper_Z.runToNewPosition(dipDistance);
     }
     ledcWrite(STEERING_CHANNEL, 0);
-    currentState = MachineState::DONE;
+    Eta::finish();
+    machineInfo.timeLeft = 0;
+    setState(MachineState::DONE);
     broadcast("DONE");
     vTaskDelay(pdMS_TO_TICKS(5000));
-    currentState = MachineState::IDLE;
+    setState(MachineState::IDLE);
     broadcast("IDLE");
 } // Done
 
@@ -16,21 +16,41 @@
 #define Z_AXIS_DIR_PIN 32
 
 // Steering motor pins
-#define STEERING_CHANNEL 4
+#define STEERING_CHANNEL 15
 #define STEERING_MOTOR_PIN 25
 
-// Mosfet pins array
-constexpr uint8_t MOSFET_PINS[MAX_BEAKERS] = {4, 5, 18, 21, 19, 22};
+// Heater mosfet pins come from Geometry::HEATER_PINS
+constexpr uint8_t HEATER_CHANNEL_BASE = 3; // LEDC channel of beaker 0, one channel per beaker
 
 // Sensor pin
 constexpr int TEMP_SENSOR_PIN = 15;
 
+extern volatile bool machineHomed; // Set once homing after boot has finished
+
 // Functions
 void heatingInit(void * params);
 bool checkSensors(uint8_t sensorNumber);
+long beakerPosition(uint8_t beakerNum);
+long storePosition(uint8_t storeIn);
+long rotaryPosition();
+void loadCalibration();
 
 #define RUN (currentState != MachineState::WORKING)
 
+#define calibrationStore "calibration"
+constexpr uint8_t STORE_IN_AIR_STATION = MAX_BEAKERS; // Station index used to teach the store-in-air position
+
+constexpr long MAX_JOG_STEPS = 400; // Largest single jog accepted from a client
+
+// Teach-in of station positions and probes. Only allowed while IDLE.
+namespace Calibrate{
+    const char* jog(long steps);
+    bool teach(uint8_t station);
+    bool teachProbe(uint8_t station);
+    bool save();
+    void reset();
+} // namespace Calibrate
+
 namespace Move{
     void dip(int duration, int rpm);
     void moveToBeaker(uint8_t beakerNum);
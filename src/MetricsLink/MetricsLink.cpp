@@ -0,0 +1,175 @@
+#include "MetricsLink.h"
+#include "MachineLink/MachineLink.h"
+#include "MachineLink/Eta.h"
+#include "OtaLink/OtaLink.h"
+
+LinkStats linkStats;
+
+// Published snapshot. Handlers only copy these out, rendering happens in metricsUpdate().
+char metricsText[METRICS_BUFFER_SIZE];
+char statusText[STATUS_BUFFER_SIZE];
+SemaphoreHandle_t metricsMutex = xSemaphoreCreateMutex();
+
+// Scratch buffers rendered outside the lock
+char metricsScratch[METRICS_BUFFER_SIZE];
+char statusScratch[STATUS_BUFFER_SIZE];
+unsigned long lastRender = 0;
+
+// Function Prototype
+void renderMetrics(size_t wsClients);
+void renderStatus(size_t wsClients);
+
+// =======================| Endpoints |===========================
+void metricsInit(AsyncWebServer& server){
+  metricsText[0] = '\0';
+  statusText[0] = '\0';
+
+  server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+    String body;
+    if (xSemaphoreTake(metricsMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
+      body = metricsText;
+      xSemaphoreGive(metricsMutex);
+    }
+    request->send(200, "text/plain; version=0.0.4", body);
+  });
+
+  server.on("/status", HTTP_GET, [](AsyncWebServerRequest *request) {
+    String body;
+    if (xSemaphoreTake(metricsMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
+      body = statusText;
+      xSemaphoreGive(metricsMutex);
+    }
+    request->send(200, "application/json", body);
+  });
+} // metricsInit
+
+// Called from the appLink loop. Re-renders both payloads at most once per METRICS_INTERVAL.
+void metricsUpdate(size_t wsClients){
+  if (lastRender != 0 && millis() - lastRender < METRICS_INTERVAL) return;
+  lastRender = millis();
+
+  renderMetrics(wsClients);
+  renderStatus(wsClients);
+  if (xSemaphoreTake(metricsMutex, portMAX_DELAY) == pdTRUE) {
+    memcpy(metricsText, metricsScratch, sizeof(metricsText));
+    memcpy(statusText, statusScratch, sizeof(statusText));
+    xSemaphoreGive(metricsMutex);
+  }
+} // metricsUpdate
+
+void metricsRecordLoop(uint32_t elapsedUs){
+  linkStats.loopTicks++;
+  linkStats.loopLastUs = elapsedUs;
+  if (elapsedUs > linkStats.loopMaxUs) linkStats.loopMaxUs = elapsedUs;
+  if (elapsedUs > LOOP_BUDGET_US) linkStats.loopOverruns++;
+} // metricsRecordLoop
+
+const char* stateName(MachineState state){
+  switch (state) {
+  case MachineState::IDLE: return "IDLE";
+  case MachineState::HOMING: return "HOMING";
+  case MachineState::WORKING: return "WORKING";
+  case MachineState::HALTED: return "HALTED";
+  case MachineState::DONE: return "DONE";
+  case MachineState::HEATING: return "HEATING";
+  case MachineState::ABORT: return "ABORT";
+  }
+  return "UNKNOWN";
+} // stateName
+
+// =======================| Rendering |===========================
+// Appends formatted text, silently truncating once the buffer is full
+void append(char* buf, size_t& len, size_t cap, const char* fmt, ...){
+  if (len >= cap - 1) return;
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf + len, cap - len, fmt, args);
+  va_end(args);
+  if (n > 0) len = min(len + n, cap - 1);
+} // append
+
+float heaterDuty(uint8_t beaker){
+  return ledcRead(HEATER_CHANNEL_BASE + beaker) / float((1 << PWM_RESOLUTION) - 1);
+} // heaterDuty
+
+void renderMetrics(size_t wsClients){
+  char* buf = metricsScratch;
+  size_t len = 0;
+  const size_t cap = sizeof(metricsScratch);
+  MachineState state = currentState;
+
+  append(buf, len, cap, "# TYPE dip_state gauge\n");
+  for (uint8_t s = uint8_t(MachineState::IDLE); s <= uint8_t(MachineState::ABORT); s++) {
+    append(buf, len, cap, "dip_state{state=\"%s\"} %d\n", stateName(MachineState(s)), s == uint8_t(state));
+  }
+  append(buf, len, cap, "# TYPE dip_power_loss gauge\ndip_power_loss %d\n", machineInfo.powerLoss ? 1 : 0);
+  append(buf, len, cap, "# TYPE dip_cycle gauge\ndip_cycle %d\n", machineInfo.onCycle);
+  append(buf, len, cap, "# TYPE dip_cycles_set gauge\ndip_cycles_set %d\n", machineInfo.setCycles);
+  append(buf, len, cap, "# TYPE dip_beaker gauge\ndip_beaker %u\n", machineInfo.onBeaker);
+  append(buf, len, cap, "# TYPE dip_active_beakers gauge\ndip_active_beakers %u\n", machineInfo.activeBeakers);
+  append(buf, len, cap, "# TYPE dip_time_left_seconds gauge\ndip_time_left_seconds %d\n", machineInfo.timeLeft);
+  append(buf, len, cap, "# TYPE dip_eta_last_predicted_seconds gauge\ndip_eta_last_predicted_seconds %d\n", Eta::lastPredicted);
+  append(buf, len, cap, "# TYPE dip_eta_last_actual_seconds gauge\ndip_eta_last_actual_seconds %d\n", Eta::lastActual);
+  append(buf, len, cap, "# TYPE dip_eta_last_error_seconds gauge\ndip_eta_last_error_seconds %d\n", Eta::lastError);
+
+  append(buf, len, cap, "# TYPE dip_beaker_temperature_celsius gauge\n");
+  for (uint8_t i = 0; i < machineInfo.activeBeakers; i++) {
+    append(buf, len, cap, "dip_beaker_temperature_celsius{beaker=\"%u\"} %.2f\n", i + 1, machineInfo.currentTemps[i]);
+  }
+  append(buf, len, cap, "# TYPE dip_beaker_setpoint_celsius gauge\n");
+  for (uint8_t i = 0; i < machineInfo.activeBeakers; i++) {
+    append(buf, len, cap, "dip_beaker_setpoint_celsius{beaker=\"%u\"} %.2f\n", i + 1, machineInfo.setDipTemperature[i]);
+  }
+  append(buf, len, cap, "# TYPE dip_beaker_heater_duty_ratio gauge\n");
+  for (uint8_t i = 0; i < machineInfo.activeBeakers; i++) {
+    append(buf, len, cap, "dip_beaker_heater_duty_ratio{beaker=\"%u\"} %.3f\n", i + 1, heaterDuty(i));
+  }
+
+  append(buf, len, cap, "# TYPE dip_uptime_seconds counter\ndip_uptime_seconds %lu\n", millis() / 1000);
+  append(buf, len, cap, "# TYPE dip_heap_free_bytes gauge\ndip_heap_free_bytes %u\n", ESP.getFreeHeap());
+  append(buf, len, cap, "# TYPE dip_heap_min_free_bytes gauge\ndip_heap_min_free_bytes %u\n", ESP.getMinFreeHeap());
+  append(buf, len, cap, "# TYPE dip_ws_clients gauge\ndip_ws_clients %u\n", (unsigned)wsClients);
+  append(buf, len, cap, "# TYPE dip_ws_connects_total counter\ndip_ws_connects_total %u\n", linkStats.wsConnects);
+  append(buf, len, cap, "# TYPE dip_ws_disconnects_total counter\ndip_ws_disconnects_total %u\n", linkStats.wsDisconnects);
+  append(buf, len, cap, "# TYPE dip_wifi_disconnects_total counter\ndip_wifi_disconnects_total %u\n", linkStats.wifiDisconnects);
+  append(buf, len, cap, "# TYPE dip_wifi_reconnects_total counter\ndip_wifi_reconnects_total %u\n", linkStats.wifiReconnects);
+  append(buf, len, cap, "# TYPE dip_loop_ticks_total counter\ndip_loop_ticks_total %u\n", linkStats.loopTicks);
+  append(buf, len, cap, "# TYPE dip_loop_overruns_total counter\ndip_loop_overruns_total %u\n", linkStats.loopOverruns);
+  append(buf, len, cap, "# TYPE dip_loop_last_microseconds gauge\ndip_loop_last_microseconds %u\n", linkStats.loopLastUs);
+  append(buf, len, cap, "# TYPE dip_loop_max_microseconds gauge\ndip_loop_max_microseconds %u\n", linkStats.loopMaxUs);
+  append(buf, len, cap, "# TYPE dip_ota_active gauge\ndip_ota_active %d\n", otaActive ? 1 : 0);
+  append(buf, len, cap, "# TYPE dip_ota_last_bytes gauge\ndip_ota_last_bytes %u\n", otaStats.bytes);
+  append(buf, len, cap, "# TYPE dip_ota_last_duration_milliseconds gauge\ndip_ota_last_duration_milliseconds %u\n", otaStats.durationMs);
+  append(buf, len, cap, "# TYPE dip_ota_last_rate_bytes_per_second gauge\ndip_ota_last_rate_bytes_per_second %u\n", otaStats.rate);
+} // renderMetrics
+
+void renderStatus(size_t wsClients){
+  JsonDocument doc;
+  doc["state"] = stateName(currentState);
+  doc["powerLoss"] = bool(machineInfo.powerLoss);
+  doc["onCycle"] = machineInfo.onCycle;
+  doc["setCycles"] = machineInfo.setCycles;
+  doc["onBeaker"] = machineInfo.onBeaker;
+  doc["timeLeft"] = machineInfo.timeLeft;
+  doc["etaError"] = Eta::lastError;
+  doc["uptime"] = millis() / 1000;
+  doc["heap"] = ESP.getFreeHeap();
+  doc["heapMin"] = ESP.getMinFreeHeap();
+  doc["clients"] = wsClients;
+  doc["wsConnects"] = linkStats.wsConnects;
+  doc["wifiDisconnects"] = linkStats.wifiDisconnects;
+  doc["wifiReconnects"] = linkStats.wifiReconnects;
+  doc["loopMaxUs"] = linkStats.loopMaxUs;
+  doc["loopOverruns"] = linkStats.loopOverruns;
+  doc["otaRate"] = otaStats.rate;
+  doc["otaDurationMs"] = otaStats.durationMs;
+
+  JsonArray beakers = doc["beakers"].to<JsonArray>();
+  for (uint8_t i = 0; i < machineInfo.activeBeakers; i++) {
+    JsonObject beaker = beakers.add<JsonObject>();
+    beaker["temp"] = machineInfo.currentTemps[i];
+    beaker["set"] = machineInfo.setDipTemperature[i];
+    beaker["duty"] = heaterDuty(i);
+  }
+  serializeJson(doc, statusScratch, sizeof(statusScratch));
+} // renderStatus
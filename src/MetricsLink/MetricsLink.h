@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Globals.h"
+
+constexpr unsigned long METRICS_INTERVAL = 1000; // How often the scrape snapshot is re-rendered
+constexpr uint32_t LOOP_BUDGET_US = 10000;       // appLink tick work above this counts as an overrun
+constexpr size_t METRICS_BUFFER_SIZE = 4096;
+constexpr size_t STATUS_BUFFER_SIZE = 1024;
+
+// Counters updated by AppLink and exported through /metrics and /status
+struct LinkStats {
+    volatile uint32_t wsConnects;
+    volatile uint32_t wsDisconnects;
+    volatile uint32_t wifiDisconnects;
+    volatile uint32_t wifiReconnects;
+    uint32_t loopTicks;
+    uint32_t loopOverruns;
+    uint32_t loopLastUs;
+    uint32_t loopMaxUs;
+};
+extern LinkStats linkStats;
+
+// Functions
+void metricsInit(AsyncWebServer& server);
+void metricsUpdate(size_t wsClients);
+void metricsRecordLoop(uint32_t elapsedUs);
+const char* stateName(MachineState state);
@@ -0,0 +1,291 @@
+#include "OtaLink.h"
+#include "MachineLink/MachineLink.h"
+#include "Update.h"
+#include "esp_ota_ops.h"
+#include "rom/miniz.h"
+
+OtaStats otaStats;
+volatile bool otaActive = false;
+
+unsigned long otaOverrideUntil = 0;
+unsigned long otaStart = 0;
+unsigned long restartAt = 0;
+bool bootPending = false; // Running image still has to prove itself
+
+// Streaming gzip state for /update, only allocated while an upload runs
+struct Inflate {
+  tinfl_decompressor decompressor;
+  uint8_t dict[TINFL_LZ_DICT_SIZE];
+  size_t dictOffset;
+  bool done;
+};
+
+// Per-request upload state, kept in request->_tempObject which the server free()s
+struct Upload {
+  Inflate* inflate;
+  const char* error; // Set once rejected, the rest of the body is ignored
+  bool owner;        // This request began Update and set otaActive
+};
+
+// Function Prototype
+void initArduinoOTA();
+void onUpload(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final);
+void uploadDisconnected(AsyncWebServerRequest *request);
+
+// Keeps the core from marking the image valid before we reach READY (when bootloader rollback is enabled)
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+// =======================| Gating |===========================
+bool otaAllowed(){
+  return MACHINE_IDLE || millis() < otaOverrideUntil;
+}
+
+// A custom header also keeps plain cross-origin form posts out, browsers cannot add one without a preflight
+bool otaAuthorized(AsyncWebServerRequest *request){
+  return request->hasHeader(OTA_TOKEN_HEADER) && request->getHeader(OTA_TOKEN_HEADER)->value() == OTA_PASSWORD;
+}
+
+void otaAllowOverride(){
+  otaOverrideUntil = millis() + OTA_OVERRIDE_WINDOW;
+  Serial.println("[OTA] Update allowed outside IDLE for the next 60 s");
+}
+
+// Sleeps just long enough to keep the average rate under OTA_MAX_BYTES_PER_SEC.
+// Only for ArduinoOTA, which runs on the appLink task. Never call it from an AsyncTCP callback.
+void throttle(size_t received){
+  unsigned long expected = uint64_t(received) * 1000 / OTA_MAX_BYTES_PER_SEC;
+  unsigned long elapsed = millis() - otaStart;
+  if (expected > elapsed) vTaskDelay(pdMS_TO_TICKS(expected - elapsed));
+  esp_task_wdt_reset();
+}
+
+void transferStarted(bool compressed){
+  otaActive = true;
+  otaStart = millis();
+  otaStats.compressed = compressed;
+}
+
+void transferFinished(size_t bytes){
+  otaActive = false;
+  otaStats.bytes = bytes;
+  otaStats.durationMs = max(1UL, millis() - otaStart);
+  otaStats.rate = uint64_t(bytes) * 1000 / otaStats.durationMs;
+  Serial.printf("[OTA] %u bytes in %u ms (%u B/s)%s\n", otaStats.bytes, otaStats.durationMs, otaStats.rate,
+                otaStats.compressed ? " compressed" : "");
+}
+
+// =======================| Rollback |===========================
+// Remembers the image we came from, so the next boot can fall back to it
+void armRollback(){
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  Preferences ota;
+  ota.begin(otaStore, false);
+  ota.putString("previous", running->label);
+  ota.putUChar("tries", 0);
+  ota.putBool("pending", true);
+  ota.end();
+}
+
+void rollBack(){
+  Preferences ota;
+  ota.begin(otaStore, false);
+  String previous = ota.getString("previous", "");
+  ota.putBool("pending", false);
+  ota.end();
+  const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, previous.c_str());
+  Serial.printf("[OTA] New image never reached READY, rolling back to %s\n", previous.c_str());
+  if (partition && esp_ota_set_boot_partition(partition) == ESP_OK) ESP.restart();
+}
+
+// Runs first thing in setup(). Counts unconfirmed boots of a fresh image.
+void otaBootCheck(){
+  Preferences ota;
+  ota.begin(otaStore, false);
+  bootPending = ota.getBool("pending", false);
+  uint8_t tries = bootPending ? ota.getUChar("tries", 0) + 1 : 0;
+  if (bootPending) ota.putUChar("tries", tries);
+  ota.end();
+  if (bootPending && tries > OTA_MAX_BOOT_TRIES) rollBack();
+}
+
+void confirmBoot(){
+  bootPending = false;
+  esp_ota_mark_app_valid_cancel_rollback();
+  Preferences ota;
+  ota.begin(otaStore, false);
+  ota.putBool("pending", false);
+  ota.end();
+  Serial.println("[OTA] Image confirmed");
+}
+
+// =======================| Setup & loop |===========================
+void otaInit(AsyncWebServer& server){
+  initArduinoOTA();
+  server.on("/update", HTTP_POST, [](AsyncWebServerRequest *request) {
+    Upload* upload = (Upload*)request->_tempObject;
+    if (!otaAuthorized(request)) request->send(401, "text/plain", "missing or wrong " OTA_TOKEN_HEADER);
+    else if (!upload) request->send(400, "text/plain", "no image");
+    else if (upload->error) request->send(423, "text/plain", upload->error);
+    else if (Update.hasError()) request->send(500, "text/plain", Update.errorString());
+    else request->send(200, "text/plain", "OK, restarting");
+  }, onUpload);
+} // otaInit
+
+// Called every appLink tick
+void otaHandle(){
+  if (bootPending) {
+    if (machineHomed && MACHINE_IDLE) confirmBoot();
+    else if (millis() > OTA_VERIFY_TIMEOUT) rollBack();
+  }
+  if (restartAt && millis() > restartAt) ESP.restart();
+  // Not listening outside IDLE: espota invitations time out instead of starving motion
+  if (otaAllowed()) ArduinoOTA.handle();
+} // otaHandle
+
+void initArduinoOTA(){
+  Serial.println("Initializing OTA");
+  ArduinoOTA
+    .onStart([]() {
+      String type;
+      if (ArduinoOTA.getCommand() == U_FLASH)
+        type = "sketch";
+      else // U_SPIFFS
+        type = "filesystem";
+      Serial.println("Start updating " + type);
+      transferStarted(false);
+    })
+    .onEnd([]() {
+      transferFinished(otaStats.bytes);
+      if (ArduinoOTA.getCommand() == U_FLASH) armRollback();
+      Serial.println("\nEnd");
+    })
+    .onProgress([](unsigned int progress, unsigned int total) {
+      Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
+      otaStats.bytes = progress;
+      throttle(progress); // Also feeds the watchdog timer
+    })
+    .onError([](ota_error_t error) {
+      otaActive = false;
+      Serial.printf("Error[%u]: ", error);
+      if (error == OTA_AUTH_ERROR) Serial.println("Auth Failed");
+      else if (error == OTA_BEGIN_ERROR) Serial.println("Begin Failed");
+      else if (error == OTA_CONNECT_ERROR) Serial.println("Connect Failed");
+      else if (error == OTA_RECEIVE_ERROR) Serial.println("Receive Failed");
+      else if (error == OTA_END_ERROR) Serial.println("End Failed");
+    });
+  ArduinoOTA.setPassword(OTA_PASSWORD);
+  ArduinoOTA.begin();
+} // initArduinoOTA
+
+// =======================| HTTP upload |===========================
+// Skips the gzip member header. Returns its length, or 0 if it does not fit the first chunk.
+size_t gzipHeaderLength(const uint8_t* data, size_t len){
+  if (len < 10 || data[2] != 8) return 0; // Deflate only
+  uint8_t flags = data[3];
+  size_t pos = 10;
+  if (flags & 0x04) { // FEXTRA
+    if (pos + 2 > len) return 0;
+    pos += 2 + (data[pos] | (data[pos + 1] << 8));
+  }
+  if (flags & 0x08) while (pos < len && data[pos++]) {} // FNAME
+  if (flags & 0x10) while (pos < len && data[pos++]) {} // FCOMMENT
+  if (flags & 0x02) pos += 2;                           // FHCRC
+  return pos < len ? pos : 0;
+}
+
+// Inflates a chunk into the update partition. Returns false on a corrupt stream.
+bool inflateChunk(Inflate* inflate, const uint8_t* in, size_t len, bool final){
+  while (!inflate->done) {
+    size_t inBytes = len;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - inflate->dictOffset;
+    tinfl_status status = tinfl_decompress(&inflate->decompressor, in, &inBytes, inflate->dict,
+                                           inflate->dict + inflate->dictOffset, &outBytes,
+                                           final ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+    in += inBytes;
+    len -= inBytes;
+    if (outBytes) Update.write(inflate->dict + inflate->dictOffset, outBytes);
+    inflate->dictOffset = (inflate->dictOffset + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+    if (status == TINFL_STATUS_DONE) inflate->done = true; // Trailing CRC and size are ignored
+    else if (status < TINFL_STATUS_DONE) return false;
+    else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && len == 0) break;
+  }
+  return true;
+}
+
+// Frees the upload's buffers and, if it owns the transfer, hands otaActive back
+void release(Upload* upload){
+  free(upload->inflate);
+  upload->inflate = nullptr;
+  if (upload->owner) {
+    upload->owner = false;
+    otaActive = false;
+  }
+}
+
+// Rejects this upload only, another upload's transfer is left alone
+void reject(Upload* upload, const char* error){
+  if (upload->owner) Update.abort();
+  release(upload);
+  upload->error = error;
+  Serial.printf("[OTA] Upload rejected: %s\n", error);
+}
+
+// The client went away mid-upload: final will never arrive, so clean up here.
+// Also runs after a completed upload, when there is nothing left to release.
+void uploadDisconnected(AsyncWebServerRequest *request){
+  Upload* upload = (Upload*)request->_tempObject;
+  if (!upload) return;
+  if (upload->owner) {
+    Update.abort();
+    Serial.println("[OTA] Upload aborted, client disconnected");
+  }
+  release(upload);
+}
+
+// Runs in the AsyncTCP task, so it never sleeps. OTA_MAX_BYTES_PER_SEC is not applied here:
+// the transfer is paced by TCP, and a delay would stall every other client.
+void onUpload(AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final){
+  Upload* upload = (Upload*)request->_tempObject;
+  if (index == 0) {
+    upload = (Upload*)calloc(1, sizeof(Upload));
+    if (!upload) return; // Answered as "no image"
+    request->_tempObject = upload;
+    request->onDisconnect([request]() { uploadDisconnected(request); });
+    if (!otaAuthorized(request)) return reject(upload, "unauthorized");
+    if (!otaAllowed()) return reject(upload, "machine busy, send allowUpdate to override");
+    if (otaActive) return reject(upload, "update already running");
+
+    bool compressed = len >= 2 && data[0] == 0x1f && data[1] == 0x8b;
+    size_t skip = 0;
+    if (compressed) {
+      skip = gzipHeaderLength(data, len);
+      upload->inflate = (Inflate*)malloc(sizeof(Inflate));
+      if (!skip || !upload->inflate) return reject(upload, skip ? "out of memory" : "unsupported gzip header");
+      tinfl_init(&upload->inflate->decompressor);
+      upload->inflate->dictOffset = 0;
+      upload->inflate->done = false;
+    }
+    if (!Update.begin(UPDATE_SIZE_UNKNOWN)) return reject(upload, "could not begin update");
+    upload->owner = true;
+    transferStarted(compressed);
+    data += skip;
+    len -= skip;
+  }
+  if (!upload || upload->error || Update.hasError()) return;
+
+  bool ok = upload->inflate ? inflateChunk(upload->inflate, data, len, final) : Update.write(data, len) == len;
+  if (!ok) return reject(upload, "corrupt image");
+
+  if (final) {
+    transferFinished(index + len);
+    bool ended = Update.end(true);
+    release(upload);
+    if (ended) {
+      armRollback();
+      restartAt = millis() + 1000; // Let the response go out first
+    }
+  }
+} // onUpload
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Globals.h"
+
+constexpr uint32_t OTA_MAX_BYTES_PER_SEC = 40000;   // ArduinoOTA transfer cap so an update never saturates the link
+constexpr unsigned long OTA_OVERRIDE_WINDOW = 60000; // How long "allowUpdate" permits an update outside IDLE
+constexpr unsigned long OTA_VERIFY_TIMEOUT = 120000; // New image must reach READY within this after boot
+constexpr uint8_t OTA_MAX_BOOT_TRIES = 3;            // Unconfirmed boots before rolling back
+#define otaStore "ota"
+
+// Shared secret for both update paths: ArduinoOTA auth and the X-OTA-Token header of POST /update.
+// Set per fleet with -D OTA_PASSWORD=\"...\" and give espota the same value with --auth.
+#ifndef OTA_PASSWORD
+#define OTA_PASSWORD "dipmachine"
+#endif
+#define OTA_TOKEN_HEADER "X-OTA-Token"
+
+// Result of the last transfer, for /metrics and /status
+struct OtaStats {
+    uint32_t bytes;      // Bytes received over the wire
+    uint32_t durationMs;
+    uint32_t rate;       // Bytes per second
+    bool compressed;
+};
+extern OtaStats otaStats;
+extern volatile bool otaActive;
+
+// Functions
+void otaBootCheck();
+void otaInit(AsyncWebServer& server);
+void otaHandle();
+void otaAllowOverride();
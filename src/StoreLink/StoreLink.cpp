@@ -0,0 +1,144 @@
+#include "StoreLink.h"
+#include "rom/crc.h"
+
+// Layout written by firmware before SNAPSHOT_VERSION 1: a raw dump of the
+// 6 station MachineInfo under the "data" key. Only read for migration.
+struct LegacyMachineInfo {
+  bool powerLoss;
+  uint8_t activeBeakers;
+  int setCycles;
+  uint8_t storeIn;
+  float setDipTemperature[6];
+  int setDipDuration[6];
+  int setDipRPM[6];
+  int timeLeft;
+  uint8_t onBeaker;
+  int onCycle;
+  float currentTemps[6];
+};
+
+namespace Store{
+// CRC over everything before the trailing crc field
+template <typename Record>
+uint32_t checksum(const Record& record){
+  return crc32_le(0, reinterpret_cast<const uint8_t*>(&record), sizeof(Record) - sizeof(uint32_t));
+}
+
+template <typename Record>
+bool readRecord(Preferences& store, const char* key, Record& record){
+  if (store.getBytesLength(key) != sizeof(Record)) return false;
+  store.getBytes(key, &record, sizeof(Record));
+  if (record.crc != checksum(record)) {
+    Serial.printf("[Store] %s CRC mismatch, ignoring\n", key);
+    return false;
+  }
+  // Future layouts are converted here, before the version check below
+  if (record.version != SNAPSHOT_VERSION) {
+    Serial.printf("[Store] %s has unknown version %d\n", key, record.version);
+    return false;
+  }
+  return true;
+}
+
+RecipeRecord packRecipe(const MachineInfo& info){
+  RecipeRecord r = {};
+  r.version = SNAPSHOT_VERSION;
+  r.stations = MAX_BEAKERS;
+  r.activeBeakers = info.activeBeakers;
+  r.storeIn = info.storeIn;
+  r.setCycles = constrain(info.setCycles, 0, 0xFFFF);
+  for (uint8_t i = 0; i < MAX_BEAKERS; i++) {
+    r.setDipTemperature[i] = lroundf(info.setDipTemperature[i] * 10);
+    r.setDipDuration[i] = constrain(info.setDipDuration[i], 0, 0xFFFF);
+    r.setDipRPM[i] = constrain(info.setDipRPM[i], 0, 0xFFFF);
+  }
+  r.crc = checksum(r);
+  return r;
+}
+
+ProgressRecord packProgress(const MachineInfo& info){
+  ProgressRecord p = {};
+  p.version = SNAPSHOT_VERSION;
+  p.flags = info.powerLoss ? PROGRESS_POWER_LOSS : 0;
+  p.onBeaker = info.onBeaker;
+  p.onCycle = constrain(info.onCycle, 0, 0xFFFF);
+  p.crc = checksum(p);
+  return p;
+}
+
+// Converts a raw pre-versioning dump and rewrites it in the current format
+bool migrateLegacy(Preferences& store, MachineInfo& info){
+  LegacyMachineInfo legacy;
+  store.getBytes("data", &legacy, sizeof(legacy));
+  store.remove("data");
+  if (MAX_BEAKERS != 6 || legacy.activeBeakers < 1 || legacy.activeBeakers > 6) return false;
+
+  info.powerLoss = legacy.powerLoss;
+  info.activeBeakers = legacy.activeBeakers;
+  info.setCycles = legacy.setCycles;
+  info.storeIn = legacy.storeIn;
+  for (uint8_t i = 0; i < 6; i++) {
+    info.setDipTemperature[i] = legacy.setDipTemperature[i];
+    info.setDipDuration[i] = legacy.setDipDuration[i];
+    info.setDipRPM[i] = legacy.setDipRPM[i];
+  }
+  info.onBeaker = legacy.onBeaker;
+  info.onCycle = legacy.onCycle;
+
+  RecipeRecord recipe = packRecipe(info);
+  ProgressRecord progress = packProgress(info);
+  store.putBytes("recipe", &recipe, sizeof(recipe));
+  store.putBytes("progress", &progress, sizeof(progress));
+  Serial.println("[Store] Migrated legacy snapshot");
+  return true;
+}
+
+bool load(MachineInfo& info){
+  Preferences store;
+  store.begin(machineInfoStore, false);
+  if (store.getBytesLength("data") == sizeof(LegacyMachineInfo)) {
+    bool migrated = migrateLegacy(store, info);
+    store.end();
+    return migrated;
+  }
+
+  RecipeRecord recipe;
+  ProgressRecord progress;
+  bool ok = readRecord(store, "recipe", recipe) && recipe.stations == MAX_BEAKERS
+         && recipe.activeBeakers >= 1 && recipe.activeBeakers <= MAX_BEAKERS;
+  if (ok) {
+    info.activeBeakers = recipe.activeBeakers;
+    info.setCycles = recipe.setCycles;
+    info.storeIn = recipe.storeIn;
+    for (uint8_t i = 0; i < MAX_BEAKERS; i++) {
+      info.setDipTemperature[i] = recipe.setDipTemperature[i] / 10.0f;
+      info.setDipDuration[i] = recipe.setDipDuration[i];
+      info.setDipRPM[i] = recipe.setDipRPM[i];
+    }
+    // A recipe without valid progress restarts from the beginning
+    if (readRecord(store, "progress", progress)) {
+      info.powerLoss = progress.flags & PROGRESS_POWER_LOSS;
+      info.onBeaker = progress.onBeaker;
+      info.onCycle = progress.onCycle;
+    }
+  }
+  store.end();
+  return ok;
+}
+
+void saveRecipe(const MachineInfo& info){
+  RecipeRecord recipe = packRecipe(info);
+  Preferences store;
+  store.begin(machineInfoStore, false);
+  store.putBytes("recipe", &recipe, sizeof(recipe));
+  store.end();
+}
+
+void saveProgress(const MachineInfo& info){
+  ProgressRecord progress = packProgress(info);
+  Preferences store;
+  store.begin(machineInfoStore, false);
+  store.putBytes("progress", &progress, sizeof(progress));
+  store.end();
+}
+} // namespace Store
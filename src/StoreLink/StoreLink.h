@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Globals.h"
+
+// Recovery data is kept in machineInfoStore as two packed, CRC-checked records:
+// the recipe, written once per start, and the progress, rewritten after every dip.
+constexpr uint8_t SNAPSHOT_VERSION = 1;
+constexpr uint8_t PROGRESS_POWER_LOSS = 0x01;
+
+struct __attribute__((packed)) RecipeRecord {
+    uint8_t version;
+    uint8_t stations;
+    uint8_t activeBeakers;
+    uint8_t storeIn;
+    uint16_t setCycles;
+    int16_t setDipTemperature[MAX_BEAKERS]; // Tenths of a degree
+    uint16_t setDipDuration[MAX_BEAKERS];   // Seconds
+    uint16_t setDipRPM[MAX_BEAKERS];
+    uint32_t crc;
+};
+
+struct __attribute__((packed)) ProgressRecord {
+    uint8_t version;
+    uint8_t flags;
+    uint8_t onBeaker;
+    uint16_t onCycle;
+    uint32_t crc;
+};
+
+namespace Store{
+    bool load(MachineInfo& info);
+    void saveRecipe(const MachineInfo& info);
+    void saveProgress(const MachineInfo& info);
+} // namespace Store
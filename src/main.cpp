@@ -1,18 +1,27 @@
 #include "Globals.h"
 #include "MachineLink/MachineLink.h"
+#include "MachineLink/Eta.h"
+#include "StoreLink/StoreLink.h"
+#include "OtaLink/OtaLink.h"
+#include "IndicatorLink/indicatorLink.h"
 // Function prototypes
 void IRAM_ATTR onPowerLoss();
+void powerLossWriter(void * params);
 void printMachineInfo(const MachineInfo& info);
 
 volatile unsigned long lastInterruptTime = 0;
-Preferences pref;
+TaskHandle_t powerLossTask = NULL;
 
 void setup() {
   Serial.begin(115200);
+  otaBootCheck();
   pinMode(POWER_LOSS_PIN, INPUT_PULLUP);
 
   xTaskCreate(appLinkInit, "appLink", 4096, NULL, 1, NULL);
   xTaskCreate(heatingInit, "machineLink", 4096, NULL, 0, NULL);
+  xTaskCreate(indicatorLink, "indicatorLink", 2048, NULL, 0, NULL);
+  // Highest of our tasks so the record is written before the supply drops out
+  xTaskCreate(powerLossWriter, "powerLoss", 3072, NULL, 3, &powerLossTask);
 
   attachInterrupt(POWER_LOSS_PIN, onPowerLoss, FALLING);
 }
@@ -24,17 +33,29 @@ void loop() {
         Move::abort();
         break;
       }
+      bool interrupted = false;
       for (size_t j = machineInfo.onBeaker; j < machineInfo.activeBeakers; j++) {
         if (RUN) {
           Move::abort();
+          interrupted = true;
           break;
         }
         Move::moveToBeaker(j);
-        Move::dip(machineInfo.setDipDuration[j], machineInfo.setDipRPM[j]);
+        if (!RUN) Move::dip(machineInfo.setDipDuration[j], machineInfo.setDipRPM[j]);
+        // Both return early on abort or power loss, this beaker is not done
+        if (RUN) {
+          interrupted = true;
+          break;
+        }
+        Eta::stepDone(j);
         machineInfo.onBeaker++;
+        Store::saveProgress(machineInfo);
       }
+      // Keeps the cursor powerLossWriter saved as the last record, recover resumes from it
+      if (interrupted) break;
       machineInfo.onBeaker = 0;
       machineInfo.onCycle++;
+      Store::saveProgress(machineInfo);
       if (machineInfo.onCycle == machineInfo.setCycles) {
         Move::done();
         break;
@@ -48,13 +69,23 @@ void IRAM_ATTR onPowerLoss() {
   unsigned long interruptTime = millis();
   // If interrupts come faster than debounceDelay, assume it's a false trigger
   if (interruptTime - lastInterruptTime > 50 && MACHINE_HEATING || MACHINE_WORKING) {
-    pref.begin(machineInfoStore); // Open pref in read-write mode
     machineInfo.powerLoss = true;
-    pref.putBytes("data", &machineInfo, sizeof(machineInfo));
-    pref.end();
-
-    digitalWrite(BUILTIN_LED, HIGH);
     currentState = MachineState::HALTED;
+    indicatorSetConditionFromISR(Condition::POWER_LOSS);
+    // NVS takes locks and writes flash, leave the progress record to powerLossWriter
+    if (powerLossTask) {
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR(powerLossTask, &woken);
+      if (woken) portYIELD_FROM_ISR();
+    }
   }
   lastInterruptTime = interruptTime;
+}
+
+void powerLossWriter(void * params) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    Store::saveProgress(machineInfo); // Recipe is already stored, only the progress record changes
+    Serial.println("[powerLossWriter] Progress saved");
+  }
 }
\ No newline at end of file
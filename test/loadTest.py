@@ -0,0 +1,292 @@
+"""WebSocket load test for the DipMachine, or for test/standinServer.py.
+
+Opens N clients against /ws. Client 0 is the controller and replays the
+newTask.py cycle: new, start, abort, recover. The other clients act like
+dashboards and send recheck and scanWiFi. The test measures:
+
+  * command to ack latency, matched per client in send order
+  * scanWiFi result latency, from the request to the network list
+  * broadcast fan-out, i.e. how much later each client sees a broadcast
+    than the first client that saw it
+  * dropped frames: broadcasts some clients never saw, and acks that
+    did not arrive within --ack-timeout
+  * device heap, polled from GET /status
+
+Needs Python 3.9+ and websockets 14 or newer (pip install websockets),
+as does test/standinServer.py.
+
+    python test/standinServer.py &
+    python test/loadTest.py --clients 8 --duration 60
+    python test/loadTest.py --url ws://DipMachine.local:8000/ws --clients 4 --slow 1
+"""
+import argparse
+import asyncio
+import collections
+import json
+import random
+import statistics
+import time
+import urllib.parse
+import urllib.request
+
+import websockets
+
+RECIPE = {
+    "activeBeakers": 2, "setCycles": 1, "storeIn": 0,
+    "setDipTemperature": [0, 0, 0, 0, 0, 0],
+    "setDipDuration": [1, 1, 1, 1, 1, 1],
+    "setDipRPM": [0, 0, 0, 0, 0, 0],
+}
+
+# Weighted command mixes, names as in AppLink COMMAND_NAMES
+MIXES = {
+    "controller": [("new", 1), ("start", 2), ("abort", 1), ("recover", 1)],
+    "dashboard": [("recheck", 4), ("scanWiFi", 1)],
+}
+
+TAIL_WINDOW = 2.0  # Broadcasts this close to the end are not counted as missed
+SCAN_FAILURES = ("scan failed", "could not start scan")  # Sent as a second scanWiFi ack instead of a list
+
+
+def command_message(name):
+    # Firmware reads "state", newTask.py and setWifi.py send "status"; send both
+    msg = {"state": name, "status": name}
+    if name == "start":
+        msg.update(RECIPE)
+    return json.dumps(msg)
+
+
+def percentiles(samples):
+    if not samples:
+        return None
+    ordered = sorted(samples)
+    pick = lambda q: ordered[min(len(ordered) - 1, int(q * len(ordered)))]
+    return {"count": len(ordered), "mean": statistics.fmean(ordered), "p50": pick(0.50),
+            "p95": pick(0.95), "p99": pick(0.99), "max": ordered[-1]}
+
+
+class Results:
+    def __init__(self):
+        self.ack_latency = collections.defaultdict(list)  # command -> [ms]
+        self.rejected = collections.Counter()              # (command, error) -> count
+        self.lost_acks = collections.Counter()
+        self.lost_scans = 0
+        self.scan_latency = []
+        self.broadcasts = []                               # (payload, client, t)
+        self.heap = []                                     # (t, heap)
+        self.connected = set()
+        self.connect_errors = 0
+        self.heap_min = None
+        self.server_dropped = None                         # Stand-in only, the firmware has no counter
+
+
+class LoadClient:
+    def __init__(self, index, args, results, mix, slow):
+        self.index = index
+        self.args = args
+        self.results = results
+        self.mix = mix
+        self.slow = slow
+        self.pending = collections.deque()  # (command, sent_at)
+        self.scans = []                     # {"sent", "acked", "answered"}, open until both arrive
+
+    def pick_command(self, rng):
+        names, weights = zip(*self.mix)
+        return rng.choices(names, weights)[0]
+
+    async def run(self, deadline):
+        try:
+            websocket = await websockets.connect(self.args.url, open_timeout=10)
+        except (OSError, websockets.InvalidHandshake, asyncio.TimeoutError):
+            self.results.connect_errors += 1
+            return
+        self.results.connected.add(self.index)
+        async with websocket:
+            receiver = asyncio.create_task(self.receive(websocket))
+            rng = random.Random(self.args.seed + self.index)
+            try:
+                while time.monotonic() < deadline:
+                    name = self.pick_command(rng)
+                    now = time.monotonic()
+                    if name == "scanWiFi":
+                        self.scans.append({"sent": now, "acked": False, "answered": False})
+                    self.pending.append((name, now))
+                    await websocket.send(command_message(name))
+                    self.expire(time.monotonic())
+                    await asyncio.sleep(rng.expovariate(self.args.rate))
+                # Every client listens until the same moment so late broadcasts are not counted as missed
+                await asyncio.sleep(deadline + self.args.ack_timeout - time.monotonic())
+            except websockets.ConnectionClosed:
+                pass
+            self.expire(float("inf"))
+            receiver.cancel()
+
+    def expire(self, now):
+        while self.pending and now - self.pending[0][1] > self.args.ack_timeout:
+            self.results.lost_acks[self.pending.popleft()[0]] += 1
+        for scan in [s for s in self.scans if now - s["sent"] > self.args.ack_timeout]:
+            self.scans.remove(scan)
+            if scan["acked"] and not scan["answered"]:  # Unacked ones already count as lost acks
+                self.results.lost_scans += 1
+
+    async def receive(self, websocket):
+        try:
+            async for message in websocket:
+                now = time.monotonic()
+                if self.slow:
+                    await asyncio.sleep(self.args.slow_delay)
+                self.handle(message, now)
+        except websockets.ConnectionClosed:
+            pass
+
+    def handle(self, message, now):
+        try:
+            doc = json.loads(message)
+        except json.JSONDecodeError:
+            return
+        if "ack" in doc:
+            # Acks name their command; "busy" and parse errors are sent before the
+            # worker queue, so match the oldest send of that name, not the oldest send.
+            name = doc["ack"]
+            if name == "scanWiFi" and doc.get("error") in SCAN_FAILURES:
+                # The scan itself failed: every acked request still waiting gets this instead of a list
+                for scan in [s for s in self.scans if s["acked"] and not s["answered"]]:
+                    self.scans.remove(scan)
+                    self.results.rejected[(name, doc["error"])] += 1
+                return
+            if name == "scanWiFi":
+                scan = next((s for s in self.scans if not s["acked"]), None)
+                if scan:
+                    scan["acked"] = True
+                    if not doc.get("ok"):
+                        self.scans.remove(scan)  # Rejected, no list will follow
+                    elif scan["answered"]:
+                        self.scans.remove(scan)
+            match = next((p for p in self.pending if p[0] == name or name == "message"), None)
+            if match is None:
+                return
+            self.pending.remove(match)
+            self.results.ack_latency[match[0]].append((now - match[1]) * 1000)
+            if not doc.get("ok"):
+                self.results.rejected[(match[0], doc.get("error", ""))] += 1
+        elif "state" in doc:
+            self.results.broadcasts.append((message, self.index, now))
+        else:
+            # Scan results carry no key of their own, one reply serves every waiting request
+            for scan in [s for s in self.scans if not s["answered"]]:
+                scan["answered"] = True
+                self.results.scan_latency.append((now - scan["sent"]) * 1000)
+                if scan["acked"]:
+                    self.scans.remove(scan)
+
+
+def fanout(results, clients, stop_at):
+    """Returns (skews in ms, missed frames per client).
+
+    The n-th copy of a payload a client receives belongs to the n-th send of
+    it, so a slow client's late copy is still matched to the right send.
+    """
+    sends = collections.defaultdict(dict)  # (payload, n) -> {client: t}
+    seen = collections.Counter()
+    for payload, index, t in results.broadcasts:
+        sends[(payload, seen[(payload, index)])][index] = t
+        seen[(payload, index)] += 1
+    skews, missed = [], collections.Counter()
+    for arrivals in sends.values():
+        first = min(arrivals.values())
+        skews.extend((t - first) * 1000 for t in arrivals.values())
+        if first > stop_at - TAIL_WINDOW:
+            continue  # Clients may have stopped listening before it arrived
+        for index in clients - arrivals.keys():
+            missed[index] += 1
+    return skews, missed
+
+
+async def poll_heap(status_url, results, deadline):
+    def fetch():
+        with urllib.request.urlopen(status_url, timeout=2) as response:
+            return json.load(response)
+    while time.monotonic() < deadline:
+        try:
+            status = await asyncio.to_thread(fetch)
+            if "heap" in status:
+                results.heap.append((time.monotonic(), status["heap"]))
+                results.heap_min = status.get("heapMin", results.heap_min)
+            results.server_dropped = status.get("dropped", results.server_dropped)
+        except (OSError, ValueError):
+            pass
+        await asyncio.sleep(1)
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--url", default="ws://127.0.0.1:8000/ws")
+    parser.add_argument("--status-url", help="Defaults to /status on the --url host")
+    parser.add_argument("--clients", type=int, default=4, help="Total clients, one is the controller")
+    parser.add_argument("--slow", type=int, default=0, help="Dashboards that read slowly")
+    parser.add_argument("--slow-delay", type=float, default=0.5, help="Seconds a slow client spends per message")
+    parser.add_argument("--rate", type=float, default=0.5, help="Commands per second per client")
+    parser.add_argument("--duration", type=float, default=30)
+    parser.add_argument("--ack-timeout", type=float, default=5)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--output", help="Write the summary as JSON")
+    args = parser.parse_args()
+
+    if not args.status_url:
+        parts = urllib.parse.urlsplit(args.url)
+        args.status_url = urllib.parse.urlunsplit(("http", parts.netloc, "/status", "", ""))
+
+    results = Results()
+    clients = [LoadClient(i, args, results, MIXES["controller" if i == 0 else "dashboard"],
+                          slow=0 < i <= args.slow)
+               for i in range(args.clients)]
+    deadline = time.monotonic() + args.duration
+    await asyncio.gather(poll_heap(args.status_url, results, deadline + args.ack_timeout),
+                         *(c.run(deadline) for c in clients))
+
+    # Only connected clients count towards fan-out, slow ones included
+    skews, missed = fanout(results, results.connected, deadline + args.ack_timeout)
+    slow = {c.index for c in clients if c.slow}
+    received = len(results.broadcasts)
+    heap = [h for _, h in results.heap]
+    summary = {
+        "url": args.url, "clients": args.clients, "slow": args.slow, "rate": args.rate, "duration": args.duration,
+        "connected": len(results.connected), "connectErrors": results.connect_errors,
+        "ackLatencyMs": {name: percentiles(v) for name, v in sorted(results.ack_latency.items())},
+        "scanLatencyMs": percentiles(results.scan_latency),
+        "rejected": {f"{name}: {error}": n for (name, error), n in results.rejected.items()},
+        "lostAcks": dict(results.lost_acks),
+        "lostScanResults": results.lost_scans,
+        "broadcastsReceived": received,
+        "broadcastsMissed": {"normal": sum(n for i, n in missed.items() if i not in slow),
+                             "slow": sum(n for i, n in missed.items() if i in slow)},
+        "serverDropped": results.server_dropped,
+        "fanoutSkewMs": percentiles(skews),
+        "heap": {"samples": len(heap), "min": min(heap), "max": max(heap), "last": heap[-1],
+                 "deviceMin": results.heap_min} if heap else None,
+    }
+
+    def fmt(p):
+        return "n/a" if not p else f"n={p['count']:<5} p50={p['p50']:7.1f} p95={p['p95']:7.1f} p99={p['p99']:7.1f} max={p['max']:7.1f} ms"
+    print(f"Clients {summary['connected']}/{args.clients} connected, {args.slow} slow, {args.duration:.0f} s")
+    for name, p in summary["ackLatencyMs"].items():
+        print(f"  ack {name:<10} {fmt(p)}")
+    print(f"  scan result    {fmt(summary['scanLatencyMs'])}")
+    print(f"  fan-out skew   {fmt(summary['fanoutSkewMs'])}")
+    m = summary["broadcastsMissed"]
+    print(f"  broadcasts {received} received, missed {m['normal']} normal / {m['slow']} slow;"
+          f" lost acks {sum(results.lost_acks.values())}, lost scan results {results.lost_scans}")
+    if results.server_dropped is not None:
+        print(f"  server dropped {results.server_dropped} frames on full client queues")
+    for reason, n in summary["rejected"].items():
+        print(f"  rejected {reason} x{n}")
+    if summary["heap"]:
+        print(f"  heap min {summary['heap']['min']} max {summary['heap']['max']} last {summary['heap']['last']},"
+              f" device low-water {summary['heap']['deviceMin']}")
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(summary, f, indent=2)
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
@@ -0,0 +1,267 @@
+"""Local stand-in for the DipMachine firmware's WebSocket and /status endpoints.
+
+Speaks the same protocol as src/AppLink.cpp closely enough for load testing:
+a status snapshot on connect, {"ack", "ok", "error"} replies from a single
+command worker, textAll style broadcasts every 3 s while working, and
+scanWiFi results sent to the requester only. Each client has an 8 message
+send queue like AsyncWebSocket, and broadcasts to a full queue are dropped.
+
+    python test/standinServer.py --port 8000
+"""
+import argparse
+import asyncio
+import json
+import random
+import time
+from http import HTTPStatus
+
+import websockets
+
+MAX_QUEUED_MESSAGES = 8   # AsyncWebSocket WS_MAX_QUEUED_MESSAGES
+SCAN_CACHE_TTL = 30.0
+MAX_BEAKERS = 6
+COMMAND_NAMES = ("scanWiFi", "setWiFi", "new", "start", "recheck", "recover", "abort",
+                 "jog", "teach", "teachProbe", "saveCalibration", "resetCalibration", "allowUpdate")
+HEAP_TOTAL = 180000
+HEAP_PER_CLIENT = 2048 + 1200  # Frame buffer plus AsyncTCP client
+
+
+class Client:
+    def __init__(self, websocket, client_id):
+        self.websocket = websocket
+        self.id = client_id
+        self.queue = asyncio.Queue(MAX_QUEUED_MESSAGES)
+        self.sender = asyncio.create_task(self.send_loop())
+
+    async def send_loop(self):
+        try:
+            while True:
+                await self.websocket.send(await self.queue.get())
+        except websockets.ConnectionClosed:
+            pass
+
+    def text(self, message):
+        """Queue a message, False if the queue is full and it was dropped."""
+        try:
+            self.queue.put_nowait(message)
+            return True
+        except asyncio.QueueFull:
+            return False
+
+
+class Machine:
+    def __init__(self, args):
+        self.args = args
+        self.state = "IDLE"
+        self.power_loss = False
+        self.info = {"timeLeft": 0, "activeBeakers": 1, "onBeaker": 0, "onCycle": 0,
+                     "setCycles": 0, "storeIn": 0}
+        self.recipe = {"currentTemp": [25.0], "setDipDuration": [0], "setDipRPM": [0],
+                       "setDipTemperature": [0]}
+        self.clients = {}
+        self.next_id = 1
+        self.snapshot = ""
+        self.commands = asyncio.Queue(8)
+        self.scan_cache = None
+        self.scan_waiting = []
+        self.dropped = 0
+        self.run_task = None
+        self.started = time.monotonic()
+        self.heap_min = HEAP_TOTAL
+
+    # ---------------- Broadcast & snapshot ----------------
+    def broadcast(self, state, error=""):
+        doc = {"state": state, **self.info, **self.recipe}
+        if error:
+            doc["error"] = error
+        self.snapshot = json.dumps(doc)
+        for client in list(self.clients.values()):
+            if not client.text(self.snapshot):
+                self.dropped += 1
+
+    def ack(self, client_id, command, ok, error=None):
+        client = self.clients.get(client_id)
+        if client is None:
+            return
+        doc = {"ack": command, "ok": ok}
+        if error:
+            doc["error"] = error
+        if not client.text(json.dumps(doc)):
+            self.dropped += 1
+
+    def status(self):
+        heap = HEAP_TOTAL - HEAP_PER_CLIENT * len(self.clients)
+        heap -= sum(c.queue.qsize() * len(self.snapshot) for c in self.clients.values())
+        self.heap_min = min(self.heap_min, heap)
+        return {"state": self.state, "onCycle": self.info["onCycle"], "setCycles": self.info["setCycles"],
+                "uptime": int(time.monotonic() - self.started), "heap": heap,
+                "heapMin": self.heap_min, "clients": len(self.clients), "dropped": self.dropped}
+
+    # ---------------- Command handling ----------------
+    @staticmethod
+    def parse(doc):
+        """Mirrors parseCommand(): an error string, or None if the command is valid."""
+        name = doc.get("state", "")
+        if name not in COMMAND_NAMES:
+            return "unknown command"
+        if name == "setWiFi" and not doc.get("ssid"):
+            return "missing ssid"
+        if name == "start":
+            beakers = doc.get("activeBeakers", 0)
+            if not 1 <= beakers <= MAX_BEAKERS:
+                return "invalid activeBeakers"
+            if doc.get("setCycles", 0) < 1:
+                return "invalid setCycles"
+            if any(len(doc.get(k, [])) < beakers for k in ("setDipTemperature", "setDipDuration", "setDipRPM")):
+                return "recipe arrays shorter than activeBeakers"
+        return None
+
+    async def worker(self):
+        while True:
+            client_id, doc = await self.commands.get()
+            await self.execute(client_id, doc)
+
+    async def execute(self, client_id, doc):
+        name = doc.get("state")
+        if name == "scanWiFi":
+            # Queued only, like requestScan(): the ack goes out first and handleScan() replies later
+            self.scan_waiting.append(client_id)
+            if self.scan_cache and time.monotonic() - self.scan_cache[0] < SCAN_CACHE_TTL:
+                asyncio.get_running_loop().call_soon(self.reply_scan)
+            elif len(self.scan_waiting) == 1:
+                asyncio.create_task(self.scan())
+        elif name == "setWiFi":
+            pass
+        elif name == "new":
+            self.info.update(onBeaker=0, onCycle=0, timeLeft=0)
+            self.state = "IDLE"
+            self.broadcast("IDLE")
+        elif name == "start":
+            if self.state != "IDLE":
+                return self.ack(client_id, name, False, "machine busy")
+            self.start(doc)
+        elif name == "recheck":
+            await asyncio.sleep(0.05 * len(self.recipe["currentTemp"]))  # 1-Wire probe
+        elif name == "recover":
+            if not self.power_loss:
+                return self.ack(client_id, name, False, "no power loss recorded")
+            self.power_loss = False
+            self.state = "HOMING"
+        elif name == "abort":
+            self.state = "IDLE"
+            if self.run_task:
+                self.run_task.cancel()
+            self.broadcast("IDLE")
+        self.ack(client_id, name, True)
+
+    async def scan(self):
+        await asyncio.sleep(self.args.scan_time)
+        if random.random() < self.args.scan_fail_rate:
+            for client_id in self.scan_waiting:  # Failures are not cached
+                self.ack(client_id, "scanWiFi", False, "scan failed")
+            self.scan_waiting = []
+            return
+        networks = {f"net-{i}": {"rssi": -40 - 7 * i, "isOpen": i % 3 == 0} for i in range(6)}
+        self.scan_cache = (time.monotonic(), json.dumps(networks))
+        self.reply_scan()
+
+    def reply_scan(self):
+        for client_id in self.scan_waiting:
+            client = self.clients.get(client_id)
+            if client and not client.text(self.scan_cache[1]):
+                self.dropped += 1
+        self.scan_waiting = []
+
+    # ---------------- Run simulation ----------------
+    def start(self, doc):
+        beakers = int(doc.get("activeBeakers", 1))
+        self.info.update(activeBeakers=beakers, setCycles=int(doc.get("setCycles", 1)),
+                         storeIn=int(doc.get("storeIn", 0)), onBeaker=0, onCycle=0)
+        for key in ("setDipDuration", "setDipRPM", "setDipTemperature"):
+            self.recipe[key] = list(doc.get(key, [0] * beakers))[:beakers]
+        self.recipe["currentTemp"] = [25.0] * beakers
+        self.state = "HEATING"
+        self.run_task = asyncio.create_task(self.run())
+
+    async def run(self):
+        scale = self.args.time_scale
+        await asyncio.sleep(2 * scale)
+        self.state = "WORKING"
+        self.broadcast("WORKING")
+        for cycle in range(self.info["setCycles"]):
+            for beaker in range(self.info["activeBeakers"]):
+                self.info.update(onCycle=cycle, onBeaker=beaker)
+                await asyncio.sleep(self.recipe["setDipDuration"][beaker] * scale + 1.5 * scale)
+        self.state = "DONE"
+        self.broadcast("DONE")
+        await asyncio.sleep(5)
+        self.state = "IDLE"
+        self.broadcast("IDLE")
+
+    async def periodic(self):
+        while True:
+            await asyncio.sleep(self.args.broadcast_interval)
+            if self.state in ("HEATING", "WORKING") and self.clients:
+                self.recipe["currentTemp"] = [round(t + random.uniform(-0.1, 0.3), 2)
+                                              for t in self.recipe["currentTemp"]]
+                self.broadcast("WORKING")
+
+    # ---------------- Connections ----------------
+    async def handler(self, websocket):
+        client = Client(websocket, self.next_id)
+        self.next_id += 1
+        self.clients[client.id] = client
+        if self.snapshot:
+            client.text(self.snapshot)
+        try:
+            async for message in websocket:
+                try:
+                    doc = json.loads(message)
+                except json.JSONDecodeError as e:
+                    self.ack(client.id, "message", False, str(e))
+                    continue
+                error = self.parse(doc)
+                if error:
+                    self.ack(client.id, "message", False, error)
+                    continue
+                if doc.get("state") == "abort":
+                    self.state = "ABORT"
+                try:
+                    self.commands.put_nowait((client.id, doc))
+                except asyncio.QueueFull:
+                    self.ack(client.id, doc["state"], False, "busy")
+        except websockets.ConnectionClosed:
+            pass
+        finally:
+            del self.clients[client.id]
+            client.sender.cancel()
+
+    def process_request(self, connection, request):
+        if request.path == "/status":
+            return connection.respond(HTTPStatus.OK, json.dumps(self.status()) + "\n")
+        if request.path != "/ws":
+            return connection.respond(HTTPStatus.NOT_FOUND, "Not found\n")
+        return None
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8000)
+    parser.add_argument("--broadcast-interval", type=float, default=3.0)
+    parser.add_argument("--scan-time", type=float, default=2.5, help="Seconds an uncached Wi-Fi scan takes")
+    parser.add_argument("--scan-fail-rate", type=float, default=0.0, help="Fraction of uncached scans that fail")
+    parser.add_argument("--time-scale", type=float, default=0.05, help="Real seconds per recipe second")
+    args = parser.parse_args()
+
+    machine = Machine(args)
+    machine.broadcast("IDLE")  # Seeds the snapshot, as checkPowerLoss() does at boot
+    asyncio.create_task(machine.worker())
+    asyncio.create_task(machine.periodic())
+    async with websockets.serve(machine.handler, args.host, args.port, process_request=machine.process_request):
+        print(f"Stand-in listening on ws://{args.host}:{args.port}/ws")
+        await asyncio.Future()
+
+
+if __name__ == "__main__":
+    asyncio.run(main())